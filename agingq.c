@@ -0,0 +1,118 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "list_head.h"
+#include "process.h"
+
+#include "agingq.h"
+#include "checkpoint.h"
+
+void agingq_init(struct agingq *q)
+{
+	procheap_init(&q->heap);
+	q->epoch = 0;
+	q->seq = 0;
+}
+
+void agingq_destroy(struct agingq *q)
+{
+	procheap_destroy(&q->heap);
+	agingq_init(q);
+}
+
+/**
+ * Whether @a should be picked before @b
+ */
+static inline bool __agingq_before(struct process *a, struct process *b)
+{
+	if (a->__agingq_key != b->__agingq_key)
+		return a->__agingq_key > b->__agingq_key;
+	return a->__agingq_seq < b->__agingq_seq;
+}
+
+void agingq_add_tail(struct agingq *q, struct process *p)
+{
+	assert(list_empty(&p->list));
+
+	p->__agingq_key = (long long)p->prio - q->epoch;
+	p->__agingq_seq = q->seq++;
+
+	procheap_push(&q->heap, p, __agingq_before);
+}
+
+void agingq_splice_tail_init(struct agingq *q, struct list_head *list)
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, list, list) {
+		list_del_init(&p->list);
+		agingq_add_tail(q, p);
+	}
+}
+
+struct process *agingq_pop(struct agingq *q)
+{
+	struct process *next = procheap_pop(&q->heap, __agingq_before);
+
+	if (!next)
+		return NULL;
+
+	next->prio = next->__agingq_key + q->epoch;
+	return next;
+}
+
+void agingq_checkpoint(struct agingq *q, struct checkpoint *c)
+{
+	checkpoint_write_s64(c, q->epoch);
+	checkpoint_write_s64(c, q->seq);
+	checkpoint_write_u32(c, q->heap.nr_queued);
+
+	for (unsigned int i = 0; i < q->heap.nr_queued; i++) {
+		struct process *p = q->heap.procs[i];
+
+		checkpoint_write_process(c, p);
+		checkpoint_write_s64(c, p->__agingq_key);
+		checkpoint_write_s64(c, p->__agingq_seq);
+	}
+}
+
+bool agingq_restore(struct agingq *q, struct checkpoint *c)
+{
+	unsigned int nr_queued;
+
+	q->epoch = checkpoint_read_s64(c);
+	q->seq = checkpoint_read_s64(c);
+	nr_queued = checkpoint_read_u32(c);
+	if (c->failed)
+		return false;
+
+	/* Lay the heap out as it was, so it pops in the same order */
+	procheap_reserve(&q->heap, nr_queued);
+	for (q->heap.nr_queued = 0; q->heap.nr_queued < nr_queued; q->heap.nr_queued++) {
+		struct process *p = checkpoint_read_process(c);
+
+		if (!p)
+			return false;
+		p->__agingq_key = checkpoint_read_s64(c);
+		p->__agingq_seq = checkpoint_read_s64(c);
+		q->heap.procs[q->heap.nr_queued] = p;
+	}
+	return !c->failed;
+}
@@ -0,0 +1,91 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __AGINGQ_H__
+#define __AGINGQ_H__
+
+#include <stdbool.h>
+
+#include "list_head.h"
+#include "process.h"
+#include "procheap.h"
+
+struct checkpoint;
+
+/***********************************************************************
+ * struct agingq
+ *
+ * DESCRIPTION
+ *   Ready queue for the priority + aging scheduler. Aging a queued process
+ *   by one tick raises its priority by 1, so instead of walking through all
+ *   the queued processes at every tick, agingq counts the ticks in @epoch and
+ *   stamps each process with @prio - @epoch when it gets enqueued. The stamp
+ *   stays put while the process waits, and the effective priority is the
+ *   stamp plus the current @epoch. Processes are kept in a binary heap on
+ *   the stamp and then on the enqueue order, which picks the same process as
+ *   scanning a FIFO list for the first one with the highest priority.
+ *
+ *   The processes in the queue are not linked through their @list field.
+ */
+struct agingq {
+	struct procheap heap;			/* The queued processes */
+
+	long long epoch;				/* # of times the queue has been aged */
+	long long seq;					/* Sequence for the next agingq_add_tail() */
+};
+
+void agingq_init(struct agingq *q);
+void agingq_destroy(struct agingq *q);
+
+/**
+ * Enqueue @p with its current @prio behind the processes with the same
+ * effective priority.
+ */
+void agingq_add_tail(struct agingq *q, struct process *p);
+
+/**
+ * Move all the processes in @list into @q in the list order, leaving @list
+ * empty. Used to absorb the processes the framework has put into @readyqueue.
+ */
+void agingq_splice_tail_init(struct agingq *q, struct list_head *list);
+
+/**
+ * Detach and return the first process with the highest effective priority,
+ * with its @prio brought up to date. Return NULL if @q is empty.
+ */
+struct process *agingq_pop(struct agingq *q);
+
+/**
+ * Save the processes in @q with their stamps into the checkpoint @c, and put
+ * them back into the empty @q. See checkpoint.h
+ */
+void agingq_checkpoint(struct agingq *q, struct checkpoint *c);
+bool agingq_restore(struct agingq *q, struct checkpoint *c);
+
+/**
+ * Increase the effective priority of every process in @q by 1, in O(1).
+ * Like the eager aging, the priority is not capped at MAX_PRIO.
+ */
+static inline void agingq_age(struct agingq *q)
+{
+	q->epoch++;
+}
+
+static inline bool agingq_empty(struct agingq *q)
+{
+	return q->heap.nr_queued == 0;
+}
+
+#endif
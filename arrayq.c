@@ -0,0 +1,359 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "list_head.h"
+#include "process.h"
+
+#include "arrayq.h"
+#include "checkpoint.h"
+
+/* After list_head.h, which defines offsetof() that <stddef.h> overrides */
+#if defined(__x86_64__) && !defined(CONFIG_NO_SIMD)
+#include <immintrin.h>
+#define ARRAYQ_X86_SIMD
+#endif
+
+#define ARRAYQ_MIN_SLOTS	64
+
+#define ARRAYQ_HOLE		UINT_MAX	/* Key of the holes */
+
+/***********************************************************************
+ * Selection kernels
+ *
+ * DESCRIPTION
+ *   min() returns the smallest of @nr keys, or UINT_MAX if @nr is 0.
+ *   first_below() returns the index of the first key below @limit, or @nr
+ *   if there is none. The keys are unsigned, so the SSE2 kernel flips their
+ *   sign bits to compare them with the signed instructions it has.
+ */
+struct arrayq_kernel {
+	unsigned int (*min)(const unsigned int *keys, unsigned int nr);
+	unsigned int (*first_below)(const unsigned int *keys, unsigned int nr, unsigned int limit);
+};
+
+static unsigned int __min_scalar(const unsigned int *keys, unsigned int nr)
+{
+	unsigned int min = UINT_MAX;
+
+	for (unsigned int i = 0; i < nr; i++) {
+		if (keys[i] < min)
+			min = keys[i];
+	}
+	return min;
+}
+
+static unsigned int __first_below_scalar(const unsigned int *keys, unsigned int nr,
+		unsigned int limit)
+{
+	for (unsigned int i = 0; i < nr; i++) {
+		if (keys[i] < limit)
+			return i;
+	}
+	return nr;
+}
+
+#ifndef ARRAYQ_X86_SIMD
+static const struct arrayq_kernel __scalar_kernel = {
+	.min = __min_scalar,
+	.first_below = __first_below_scalar,
+};
+#else
+static unsigned int __min_sse2(const unsigned int *keys, unsigned int nr)
+{
+	const __m128i sign = _mm_set1_epi32(INT_MIN);
+	__m128i min = _mm_set1_epi32(INT_MAX);	/* UINT_MAX with the sign bit flipped */
+	unsigned int lanes[4];
+	unsigned int i, rest;
+
+	for (i = 0; i + 4 <= nr; i += 4) {
+		__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(keys + i)), sign);
+		__m128i less = _mm_cmplt_epi32(v, min);
+
+		min = _mm_or_si128(_mm_and_si128(less, v), _mm_andnot_si128(less, min));
+	}
+	_mm_storeu_si128((__m128i *)lanes, _mm_xor_si128(min, sign));
+
+	rest = __min_scalar(keys + i, nr - i);
+	return __min_scalar(lanes, 4) < rest ? __min_scalar(lanes, 4) : rest;
+}
+
+static unsigned int __first_below_sse2(const unsigned int *keys, unsigned int nr,
+		unsigned int limit)
+{
+	const __m128i sign = _mm_set1_epi32(INT_MIN);
+	const __m128i bound = _mm_set1_epi32(limit ^ INT_MIN);
+	unsigned int i;
+
+	for (i = 0; i + 4 <= nr; i += 4) {
+		__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(keys + i)), sign);
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, bound)));
+
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	return i + __first_below_scalar(keys + i, nr - i, limit);
+}
+
+static const struct arrayq_kernel __sse2_kernel = {
+	.min = __min_sse2,
+	.first_below = __first_below_sse2,
+};
+
+__attribute__((target("avx2")))
+static unsigned int __min_avx2(const unsigned int *keys, unsigned int nr)
+{
+	__m256i min = _mm256_set1_epi32(-1);
+	__m128i half;
+	unsigned int i, lanes, rest;
+
+	for (i = 0; i + 8 <= nr; i += 8) {
+		min = _mm256_min_epu32(min, _mm256_loadu_si256((const __m256i *)(keys + i)));
+	}
+	half = _mm_min_epu32(_mm256_castsi256_si128(min), _mm256_extracti128_si256(min, 1));
+	half = _mm_min_epu32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+	half = _mm_min_epu32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+	lanes = _mm_cvtsi128_si32(half);
+
+	rest = __min_scalar(keys + i, nr - i);
+	return lanes < rest ? lanes : rest;
+}
+
+__attribute__((target("avx2")))
+static unsigned int __first_below_avx2(const unsigned int *keys, unsigned int nr,
+		unsigned int limit)
+{
+	const __m256i sign = _mm256_set1_epi32(INT_MIN);
+	const __m256i bound = _mm256_set1_epi32(limit ^ INT_MIN);
+	unsigned int i;
+
+	for (i = 0; i + 8 <= nr; i += 8) {
+		__m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(keys + i)), sign);
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(bound, v)));
+
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	return i + __first_below_scalar(keys + i, nr - i, limit);
+}
+
+static const struct arrayq_kernel __avx2_kernel = {
+	.min = __min_avx2,
+	.first_below = __first_below_avx2,
+};
+#endif
+
+static const struct arrayq_kernel *__select_kernel(void)
+{
+#ifdef ARRAYQ_X86_SIMD
+	if (__builtin_cpu_supports("avx2"))
+		return &__avx2_kernel;
+	return &__sse2_kernel;
+#else
+	return &__scalar_kernel;
+#endif
+}
+
+/***********************************************************************
+ * The queue
+ */
+void arrayq_init(struct arrayq *q)
+{
+	memset(q, 0x00, sizeof(*q));
+	q->kernel = __select_kernel();
+}
+
+void arrayq_destroy(struct arrayq *q)
+{
+	free(q->processes);
+	free(q->lifespans);
+	free(q->remainings);
+	arrayq_init(q);
+}
+
+static void *__alloc_slots(size_t size, unsigned int nr_slots)
+{
+	void *slots = malloc(size * nr_slots);
+
+	if (!slots) {
+		fprintf(stderr, "Out of memory\n");
+		abort();
+	}
+	return slots;
+}
+
+/**
+ * Move the processes to fresh arrays without the holes, leaving a quarter of
+ * the free slots in front and the rest behind them. The arrays grow so that
+ * at least half of them are free.
+ */
+static void __arrayq_relayout(struct arrayq *q)
+{
+	unsigned int nr_slots = q->nr_slots ? q->nr_slots : ARRAYQ_MIN_SLOTS;
+	struct process **processes;
+	unsigned int *lifespans, *remainings;
+	unsigned int head, n = 0;
+
+	while (nr_slots < 2 * (q->nr_queued + 1)) {
+		nr_slots *= 2;
+	}
+	head = (nr_slots - q->nr_queued) / 4;
+
+	processes = __alloc_slots(sizeof(*processes), nr_slots);
+	lifespans = __alloc_slots(sizeof(*lifespans), nr_slots);
+	remainings = __alloc_slots(sizeof(*remainings), nr_slots);
+
+	for (unsigned int i = q->head; i < q->tail; i++) {
+		if (!q->processes[i])
+			continue;
+		processes[head + n] = q->processes[i];
+		lifespans[head + n] = q->lifespans[i];
+		remainings[head + n] = q->remainings[i];
+		n++;
+	}
+	assert(n == q->nr_queued);
+
+	free(q->processes);
+	free(q->lifespans);
+	free(q->remainings);
+	q->processes = processes;
+	q->lifespans = lifespans;
+	q->remainings = remainings;
+	q->nr_slots = nr_slots;
+	q->head = head;
+	q->tail = head + n;
+}
+
+static inline void __arrayq_set(struct arrayq *q, unsigned int i, struct process *p)
+{
+	assert(list_empty(&p->list));
+
+	q->processes[i] = p;
+	q->lifespans[i] = p->lifespan;
+	q->remainings[i] = p->lifespan - p->age;
+	q->nr_queued++;
+}
+
+void arrayq_add_tail(struct arrayq *q, struct process *p)
+{
+	if (q->tail == q->nr_slots)
+		__arrayq_relayout(q);
+	__arrayq_set(q, q->tail++, p);
+}
+
+void arrayq_add(struct arrayq *q, struct process *p)
+{
+	if (q->head == 0)
+		__arrayq_relayout(q);
+	__arrayq_set(q, --q->head, p);
+}
+
+void arrayq_splice_tail_init(struct arrayq *q, struct list_head *list)
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, list, list) {
+		list_del_init(&p->list);
+		arrayq_add_tail(q, p);
+	}
+}
+
+/**
+ * Detach the process at slot @i, leaving a hole there unless it is at either
+ * end of the queue
+ */
+static struct process *__arrayq_take(struct arrayq *q, unsigned int i)
+{
+	struct process *p = q->processes[i];
+
+	q->processes[i] = NULL;
+	q->lifespans[i] = q->remainings[i] = ARRAYQ_HOLE;
+	q->nr_queued--;
+
+	while (q->head < q->tail && !q->processes[q->head]) {
+		q->head++;
+	}
+	while (q->tail > q->head && !q->processes[q->tail - 1]) {
+		q->tail--;
+	}
+	if (q->tail - q->head > 2 * q->nr_queued + ARRAYQ_MIN_SLOTS)
+		__arrayq_relayout(q);
+	return p;
+}
+
+struct process *arrayq_pop(struct arrayq *q)
+{
+	if (!q->nr_queued)
+		return NULL;
+	return __arrayq_take(q, q->head);
+}
+
+struct process *arrayq_pop_shortest(struct arrayq *q)
+{
+	unsigned int nr = q->tail - q->head;
+	unsigned int min, i;
+
+	if (!q->nr_queued)
+		return NULL;
+
+	min = q->kernel->min(q->lifespans + q->head, nr);
+	if (min == ARRAYQ_HOLE) {
+		/* Everyone lives that long. The first one then */
+		return __arrayq_take(q, q->head);
+	}
+	i = q->kernel->first_below(q->lifespans + q->head, nr, min + 1);
+	return __arrayq_take(q, q->head + i);
+}
+
+struct process *arrayq_pop_first_below(struct arrayq *q, unsigned int remaining)
+{
+	unsigned int nr = q->tail - q->head;
+	unsigned int i;
+
+	if (!q->nr_queued)
+		return NULL;
+
+	i = q->kernel->first_below(q->remainings + q->head, nr, remaining);
+	return i < nr ? __arrayq_take(q, q->head + i) : NULL;
+}
+
+void arrayq_checkpoint(struct arrayq *q, struct checkpoint *c)
+{
+	checkpoint_write_u32(c, q->nr_queued);
+	for (unsigned int i = q->head; i < q->tail; i++) {
+		if (q->processes[i])
+			checkpoint_write_process(c, q->processes[i]);
+	}
+}
+
+bool arrayq_restore(struct arrayq *q, struct checkpoint *c)
+{
+	unsigned int nr_queued = checkpoint_read_u32(c);
+
+	for (unsigned int i = 0; i < nr_queued && !c->failed; i++) {
+		struct process *p = checkpoint_read_process(c);
+
+		if (!p)
+			return false;
+		arrayq_add_tail(q, p);
+	}
+	return !c->failed;
+}
@@ -0,0 +1,105 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __ARRAYQ_H__
+#define __ARRAYQ_H__
+
+#include <stdbool.h>
+
+#include "list_head.h"
+#include "process.h"
+
+struct checkpoint;
+
+/***********************************************************************
+ * struct arrayq
+ *
+ * DESCRIPTION
+ *   Ready queue for the shortest-first schedulers, which pick the process
+ *   with the smallest key out of all the ready ones at every schedule().
+ *   The queue is a struct of arrays; the processes in the queueing order,
+ *   and their lifespans and remaining times in parallel arrays of 32-bit
+ *   keys, so that the pick streams over the keys with SIMD (AVX2 or SSE2 on
+ *   x86-64, scalar elsewhere or with `make NO_SIMD=1`) instead of chasing
+ *   the list of processes.
+ *
+ *   The position in the arrays is the queueing order. The queue occupies
+ *   [@head, @tail) with room on both sides for arrayq_add() and
+ *   arrayq_add_tail(). A process detached from the middle leaves a hole
+ *   with UINT_MAX keys, which no pick selects, and the holes are compacted
+ *   away once they outnumber the processes. The remaining time is taken
+ *   when the process is enqueued, and it does not change as the process
+ *   does not run while queued.
+ *
+ *   The processes in the queue are not linked through their @list field.
+ */
+struct arrayq {
+	struct process **processes;		/* NULL for the holes */
+	unsigned int *lifespans;
+	unsigned int *remainings;		/* lifespan - age at enqueue */
+	unsigned int head;				/* The first slot in use */
+	unsigned int tail;				/* The slot next to the last in use */
+	unsigned int nr_slots;			/* # of slots the arrays have */
+	unsigned int nr_queued;			/* # of processes in [@head, @tail) */
+
+	const struct arrayq_kernel *kernel;
+									/* Selection kernel for this CPU */
+};
+
+void arrayq_init(struct arrayq *q);
+void arrayq_destroy(struct arrayq *q);
+
+/**
+ * Enqueue @p at the tail, or at the head with arrayq_add(), like
+ * list_add_tail() and list_add() do
+ */
+void arrayq_add_tail(struct arrayq *q, struct process *p);
+void arrayq_add(struct arrayq *q, struct process *p);
+
+/**
+ * Move all the processes in @list into @q in the list order, leaving @list
+ * empty. Used to absorb the processes the framework has put into @readyqueue.
+ */
+void arrayq_splice_tail_init(struct arrayq *q, struct list_head *list);
+
+/**
+ * Detach and return the first process in the queueing order
+ */
+struct process *arrayq_pop(struct arrayq *q);
+
+/**
+ * Detach and return the first process with the smallest @lifespan
+ */
+struct process *arrayq_pop_shortest(struct arrayq *q);
+
+/**
+ * Detach and return the first process with less than @remaining ticks to
+ * run. Return NULL if there is none.
+ */
+struct process *arrayq_pop_first_below(struct arrayq *q, unsigned int remaining);
+
+/**
+ * Save the processes in @q in the queueing order into the checkpoint @c, and
+ * put them back into the empty @q. See checkpoint.h
+ */
+void arrayq_checkpoint(struct arrayq *q, struct checkpoint *c);
+bool arrayq_restore(struct arrayq *q, struct checkpoint *c);
+
+static inline bool arrayq_empty(struct arrayq *q)
+{
+	return q->nr_queued == 0;
+}
+
+#endif
@@ -0,0 +1,93 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "list_head.h"
+#include "process.h"
+
+#include "checkpoint.h"
+
+#define CHECKPOINT_INITIAL_SLOTS	256
+
+void checkpoint_init(struct checkpoint *c, FILE *file)
+{
+	memset(c, 0x00, sizeof(*c));
+	c->file = file;
+}
+
+void checkpoint_destroy(struct checkpoint *c)
+{
+	/* Forget the indices so that the next checkpoint starts over */
+	for (unsigned int i = 0; i < c->nr_processes; i++) {
+		c->processes[i]->__cold->__checkpoint_id = 0;
+	}
+	free(c->processes);
+	checkpoint_init(c, NULL);
+}
+
+void checkpoint_write(struct checkpoint *c, const void *data, size_t size)
+{
+	if (!c->failed && fwrite(data, size, 1, c->file) != 1)
+		c->failed = true;
+}
+
+void checkpoint_read(struct checkpoint *c, void *data, size_t size)
+{
+	if (!c->failed && fread(data, size, 1, c->file) != 1)
+		c->failed = true;
+}
+
+void checkpoint_add_process(struct checkpoint *c, struct process *p)
+{
+	if (c->nr_processes == c->nr_slots) {
+		unsigned int nr_slots = c->nr_slots ? c->nr_slots * 2 : CHECKPOINT_INITIAL_SLOTS;
+		struct process **processes = realloc(c->processes, sizeof(*processes) * nr_slots);
+		if (!processes) {
+			fprintf(stderr, "Out of memory\n");
+			abort();
+		}
+		c->processes = processes;
+		c->nr_slots = nr_slots;
+	}
+	c->processes[c->nr_processes++] = p;
+	p->__cold->__checkpoint_id = c->nr_processes;
+}
+
+void checkpoint_write_process(struct checkpoint *c, struct process *p)
+{
+	if (!p) {
+		checkpoint_write_u32(c, CHECKPOINT_NONE);
+		return;
+	}
+	if (!p->__cold->__checkpoint_id)
+		checkpoint_add_process(c, p);
+	checkpoint_write_u32(c, p->__cold->__checkpoint_id - 1);
+}
+
+struct process *checkpoint_read_process(struct checkpoint *c)
+{
+	uint32_t index = checkpoint_read_u32(c);
+
+	if (c->failed || index == CHECKPOINT_NONE)
+		return NULL;
+	if (index >= c->nr_processes) {
+		c->failed = true;
+		return NULL;
+	}
+	return c->processes[index];
+}
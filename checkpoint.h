@@ -0,0 +1,153 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct process;
+
+/***********************************************************************
+ * Simulation checkpoint
+ *
+ * DESCRIPTION
+ *   sched --checkpoint-every writes the whole state of the simulation at
+ *   the beginning of every n-th tick, and --resume-from picks the simulation
+ *   up from one of them. A checkpoint consists of
+ *
+ *     struct checkpoint_header
+ *     the process table; a struct checkpoint_process for each live or yet
+ *       to fork process, each followed by its schedules to acquire, its
+ *       schedules holding (as struct workload_schedule with the remaining
+ *       duration), and the ids of the resources in its @holding
+ *     the metrics records of the exited processes
+ *     the state of each CPU; @current, @readyqueue, and then whatever the
+ *       scheduler saves in its checkpoint() callback
+ *     the owner and the waitqueues of the resources in use
+ *     the fork queue
+ *
+ *   Processes are referred to with their index in the process table. The
+ *   fields are in the host byte order.
+ */
+#define CHECKPOINT_MAGIC	"SCHEDCKP"
+#define CHECKPOINT_VERSION	5
+
+#define CHECKPOINT_NONE		UINT32_MAX	/* No process, no resource */
+
+struct checkpoint_header {
+	char magic[8];				/* CHECKPOINT_MAGIC without the trailing '\0' */
+	uint32_t version;			/* CHECKPOINT_VERSION */
+	uint32_t tick;				/* Taken at the beginning of this tick */
+	uint32_t nr_cpus;
+	uint32_t nr_resources;
+	uint32_t nr_processes;		/* # of entries in the process table */
+	uint32_t nr_records;		/* # of metrics records */
+	char scheduler[32];			/* Name of the scheduler, '\0'-padded */
+	uint64_t busy_ticks;
+	uint64_t idle_ticks;
+	uint64_t nr_context_switches;
+	uint64_t inversion_ticks;
+};
+
+struct checkpoint_process {
+	uint32_t pid;
+	uint32_t status;
+	uint32_t age;
+	uint32_t lifespan;
+	uint32_t prio;
+	uint32_t prio_orig;
+	uint32_t starts_at;
+	uint32_t cpu;
+	uint32_t blocked_on;		/* Resource id, or CHECKPOINT_NONE */
+	uint32_t nr_to_acquire;
+	uint32_t nr_holding;
+	uint32_t nr_held;			/* # of resources in @holding */
+	uint32_t first_run_at;
+	uint32_t blocked_at;
+	uint32_t blocked_ticks;
+	uint32_t nr_preemptions;
+	uint32_t waiting_for;		/* Resource id, or CHECKPOINT_NONE */
+	uint32_t __reserved;
+	int64_t queue_state[2];		/* Per-process state of the ready queue, as is */
+};
+
+/**
+ * The stream being written or read. The schedulers and the queues put their
+ * state in it through the functions below, which turn processes into their
+ * indices and back. Errors stick to @failed, so there is no need to check
+ * each of them.
+ */
+struct checkpoint {
+	FILE *file;
+	bool failed;
+
+	struct process **processes;	/* Process table */
+	unsigned int nr_processes;
+	unsigned int nr_slots;
+};
+
+void checkpoint_init(struct checkpoint *c, FILE *file);
+void checkpoint_destroy(struct checkpoint *c);
+
+void checkpoint_write(struct checkpoint *c, const void *data, size_t size);
+void checkpoint_read(struct checkpoint *c, void *data, size_t size);
+
+/**
+ * Write a reference to @p, which may be NULL. The first reference to @p adds it
+ * to the process table
+ */
+void checkpoint_write_process(struct checkpoint *c, struct process *p);
+
+/**
+ * Read a reference written by checkpoint_write_process(). The processes in
+ * the table should have been set up with checkpoint_add_process()
+ */
+struct process *checkpoint_read_process(struct checkpoint *c);
+
+/**
+ * Append @p to the process table being read
+ */
+void checkpoint_add_process(struct checkpoint *c, struct process *p);
+
+static inline void checkpoint_write_u32(struct checkpoint *c, uint32_t value)
+{
+	checkpoint_write(c, &value, sizeof(value));
+}
+
+static inline uint32_t checkpoint_read_u32(struct checkpoint *c)
+{
+	uint32_t value = 0;
+
+	checkpoint_read(c, &value, sizeof(value));
+	return value;
+}
+
+static inline void checkpoint_write_s64(struct checkpoint *c, int64_t value)
+{
+	checkpoint_write(c, &value, sizeof(value));
+}
+
+static inline int64_t checkpoint_read_s64(struct checkpoint *c)
+{
+	int64_t value = 0;
+
+	checkpoint_read(c, &value, sizeof(value));
+	return value;
+}
+
+#endif
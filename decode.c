@@ -0,0 +1,87 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+/**
+ * Decode the binary event trace written by sched -t into the text format that
+ * sched prints to stderr.
+ */
+int main(int argc, char *const argv[])
+{
+	struct trace_header header;
+	struct trace_record r;
+	FILE *file;
+
+	if (argc != 2) {
+		printf("Usage: %s [trace file]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	file = fopen(argv[1], "rb");
+	if (!file) {
+		fprintf(stderr, "Cannot open %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+			memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) ||
+			header.version != TRACE_VERSION ||
+			header.record_size != sizeof(r)) {
+		fprintf(stderr, "%s is not a trace of this version\n", argv[1]);
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+
+	while (fread(&r, sizeof(r), 1, file) == 1) {
+		if (header.nr_cpus > 1) {
+			printf("%3d/%d: ", r.tick, r.cpu);
+		} else {
+			printf("%3d: ", r.tick);
+		}
+		for (unsigned int i = 0; i < r.pid; i++) {
+			fputs("    ", stdout);
+		}
+
+		switch (r.type) {
+		case TRACE_FORK:
+		case TRACE_EXIT:
+			printf("%c\n", r.type);
+			break;
+		case TRACE_BLOCK:
+		case TRACE_ACQUIRE:
+		case TRACE_RELEASE:
+			printf("\b\b%c[%d]\n", r.type, r.resource_id);
+			break;
+		case TRACE_RUN:
+			printf("%d\n", r.pid);
+			break;
+		case TRACE_IDLE:
+			printf("idle\n");
+			break;
+		default:
+			fprintf(stderr, "Unknown event type %d at tick %d\n", r.type, r.tick);
+			fclose(file);
+			return EXIT_FAILURE;
+		}
+	}
+
+	fclose(file);
+	return EXIT_SUCCESS;
+}
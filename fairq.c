@@ -0,0 +1,118 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "list_head.h"
+#include "process.h"
+
+#include "fairq.h"
+#include "checkpoint.h"
+
+void fairq_init(struct fairq *q)
+{
+	procheap_init(&q->heap);
+	q->vtime = 0;
+	q->seq = 0;
+}
+
+void fairq_destroy(struct fairq *q)
+{
+	procheap_destroy(&q->heap);
+	fairq_init(q);
+}
+
+/**
+ * Whether @a should be picked before @b
+ */
+static inline bool __fairq_before(struct process *a, struct process *b)
+{
+	if (a->__fairq_key != b->__fairq_key)
+		return a->__fairq_key < b->__fairq_key;
+	return a->__fairq_seq < b->__fairq_seq;
+}
+
+void fairq_add_tail(struct fairq *q, struct process *p)
+{
+	assert(list_empty(&p->list));
+
+	if (p->__fairq_key < q->vtime)
+		p->__fairq_key = q->vtime;
+	p->__fairq_seq = q->seq++;
+
+	procheap_push(&q->heap, p, __fairq_before);
+}
+
+void fairq_splice_tail_init(struct fairq *q, struct list_head *list)
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, list, list) {
+		list_del_init(&p->list);
+		fairq_add_tail(q, p);
+	}
+}
+
+struct process *fairq_pop(struct fairq *q)
+{
+	struct process *next = procheap_pop(&q->heap, __fairq_before);
+
+	if (!next)
+		return NULL;
+
+	if (next->__fairq_key > q->vtime)
+		q->vtime = next->__fairq_key;
+	return next;
+}
+
+void fairq_checkpoint(struct fairq *q, struct checkpoint *c)
+{
+	checkpoint_write_s64(c, q->vtime);
+	checkpoint_write_s64(c, q->seq);
+	checkpoint_write_u32(c, q->heap.nr_queued);
+
+	for (unsigned int i = 0; i < q->heap.nr_queued; i++) {
+		struct process *p = q->heap.procs[i];
+
+		checkpoint_write_process(c, p);
+		checkpoint_write_s64(c, p->__fairq_seq);
+	}
+}
+
+bool fairq_restore(struct fairq *q, struct checkpoint *c)
+{
+	unsigned int nr_queued;
+
+	q->vtime = checkpoint_read_s64(c);
+	q->seq = checkpoint_read_s64(c);
+	nr_queued = checkpoint_read_u32(c);
+	if (c->failed)
+		return false;
+
+	/* Lay the heap out as it was, so it pops in the same order */
+	procheap_reserve(&q->heap, nr_queued);
+	for (q->heap.nr_queued = 0; q->heap.nr_queued < nr_queued; q->heap.nr_queued++) {
+		struct process *p = checkpoint_read_process(c);
+
+		if (!p)
+			return false;
+		p->__fairq_seq = checkpoint_read_s64(c);
+		q->heap.procs[q->heap.nr_queued] = p;
+	}
+	return !c->failed;
+}
@@ -0,0 +1,86 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __FAIRQ_H__
+#define __FAIRQ_H__
+
+#include <stdbool.h>
+
+#include "list_head.h"
+#include "process.h"
+#include "procheap.h"
+
+struct checkpoint;
+
+/***********************************************************************
+ * struct fairq
+ *
+ * DESCRIPTION
+ *   Ready queue for the proportional-share schedulers. Each process carries
+ *   its virtual time in @__fairq_key; the pass of the stride scheduler or
+ *   the vruntime of the CFS-like one, which advances as the process runs
+ *   in inverse proportion to its weight. fairq keeps the processes in a
+ *   binary heap on the key and then on the enqueue order, so the one that
+ *   has received the least service is picked in O(log n).
+ *
+ *   @vtime follows the key of the processes popped. A process joining the
+ *   queue is placed no earlier than that, so that newly forked processes and
+ *   processes back from a long wait do not monopolize the CPU with the
+ *   credit they would have otherwise.
+ *
+ *   The processes in the queue are not linked through their @list field.
+ */
+struct fairq {
+	struct procheap heap;			/* The queued processes */
+
+	long long vtime;				/* The virtual time of the queue */
+	long long seq;					/* Sequence for the next fairq_add_tail() */
+};
+
+void fairq_init(struct fairq *q);
+void fairq_destroy(struct fairq *q);
+
+/**
+ * Enqueue @p behind the processes with the same key, bringing its key up to
+ * @vtime first
+ */
+void fairq_add_tail(struct fairq *q, struct process *p);
+
+/**
+ * Move all the processes in @list into @q in the list order, leaving @list
+ * empty. Used to absorb the processes the framework has put into @readyqueue.
+ */
+void fairq_splice_tail_init(struct fairq *q, struct list_head *list);
+
+/**
+ * Detach and return the first process with the smallest key, advancing
+ * @vtime to its key. Return NULL if @q is empty.
+ */
+struct process *fairq_pop(struct fairq *q);
+
+/**
+ * Save the processes in @q in the order of the heap into the checkpoint @c,
+ * and put them back into the empty @q. Their keys are saved along with the
+ * processes themselves. See checkpoint.h
+ */
+void fairq_checkpoint(struct fairq *q, struct checkpoint *c);
+bool fairq_restore(struct fairq *q, struct checkpoint *c);
+
+static inline bool fairq_empty(struct fairq *q)
+{
+	return q->heap.nr_queued == 0;
+}
+
+#endif
@@ -0,0 +1,364 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "workload.h"
+
+#define MAX_PRIO			64	/* Keep in line with process.h */
+#define MAX_NR_ACQUIRES		8	/* Maximum number of acquisitions of a process */
+
+/***********************************************************************
+ * Synthetic workload generator
+ *
+ * DESCRIPTION
+ *   Generate @nr_processes processes from the seeded distributions below,
+ *   either as a process script on stdout or as a workload image (see
+ *   workload.h) that sched can run directly. The same options and seed give
+ *   the same workload on any host.
+ *
+ *   Each process acquires distinct resources in the increasing order of their
+ *   ids, and holds them until its lifespan runs out at the latest. Processes
+ *   therefore never deadlock on resources whatever the scheduler does.
+ */
+enum distribution {
+	DIST_FIXED,		/* Always the mean */
+	DIST_UNIFORM,	/* Uniform over [0, 2 * mean] */
+	DIST_EXP,		/* Exponential with the mean */
+	DIST_BURST,		/* Arrivals only. @burst processes at a time */
+};
+
+static const char *__distributions[] = {
+	[DIST_FIXED] = "fixed",
+	[DIST_UNIFORM] = "uniform",
+	[DIST_EXP] = "exp",
+	[DIST_BURST] = "burst",
+};
+
+struct generator {
+	uint64_t seed;
+	unsigned int nr_processes;
+
+	enum distribution arrival;
+	double arrival_gap;			/* Mean ticks between two arrivals */
+	unsigned int burst;			/* # of processes arriving at a time with DIST_BURST */
+
+	enum distribution lifespan;
+	double lifespan_mean;
+
+	unsigned int prio_spread;	/* Priorities are uniform over [0, @prio_spread] */
+
+	unsigned int nr_resources;	/* No acquisition if 0 */
+	double contention;			/* Probability of a process acquiring resources */
+	unsigned int max_acquires;	/* Up to this many acquisitions per process */
+
+	/* The state of the generation */
+	uint64_t __rng;
+	double __now;
+	unsigned int __pid;
+};
+
+struct generated_process {
+	unsigned int pid;
+	unsigned int starts_at;
+	unsigned int lifespan;
+	unsigned int prio;
+	unsigned int nr_acquires;
+	struct workload_schedule acquires[MAX_NR_ACQUIRES];
+};
+
+/**
+ * splitmix64; small, fast, and the same everywhere unlike rand()
+ */
+static uint64_t __random(struct generator *g)
+{
+	uint64_t z = (g->__rng += 0x9e3779b97f4a7c15ULL);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * Uniform over [0, 1)
+ */
+static double __random_double(struct generator *g)
+{
+	return (__random(g) >> 11) * (1.0 / (1ULL << 53));
+}
+
+/**
+ * Uniform over [from, to]
+ */
+static unsigned int __random_between(struct generator *g, unsigned int from, unsigned int to)
+{
+	return from + __random(g) % ((uint64_t)to - from + 1);
+}
+
+static double __sample(struct generator *g, enum distribution dist, double mean)
+{
+	switch (dist) {
+	case DIST_UNIFORM:
+		return __random_double(g) * 2 * mean;
+	case DIST_EXP:
+		return -log(1.0 - __random_double(g)) * mean;
+	default:
+		return mean;
+	}
+}
+
+static void __rewind(struct generator *g)
+{
+	g->__rng = g->seed;
+	g->__now = 0;
+	g->__pid = 0;
+}
+
+static void __generate(struct generator *g, struct generated_process *p)
+{
+	unsigned int nr_acquires = 0;
+
+	p->pid = ++g->__pid;
+
+	if (g->arrival == DIST_BURST) {
+		p->starts_at = (unsigned int)((p->pid - 1) / g->burst * g->arrival_gap * g->burst);
+	} else {
+		p->starts_at = (unsigned int)g->__now;
+		g->__now += __sample(g, g->arrival, g->arrival_gap);
+	}
+
+	p->lifespan = 1 + (unsigned int)__sample(g, g->lifespan, g->lifespan_mean - 1);
+	p->prio = __random_between(g, 0, g->prio_spread);
+
+	if (g->nr_resources && __random_double(g) < g->contention)
+		nr_acquires = __random_between(g, 1, g->max_acquires);
+	if (nr_acquires > g->nr_resources)
+		nr_acquires = g->nr_resources;
+
+	/**
+	 * Pick @nr_acquires distinct resources in the increasing order, and
+	 * acquire them in that order no earlier than the previous one
+	 */
+	p->nr_acquires = 0;
+	for (unsigned int i = 0, at = 0; i < nr_acquires; i++) {
+		unsigned int from = i ? p->acquires[i - 1].resource_id + 1 : 0;
+		unsigned int to = g->nr_resources - (nr_acquires - i);
+		struct workload_schedule *s = p->acquires + p->nr_acquires;
+
+		if (from > to)
+			break;
+		s->resource_id = __random_between(g, from, to);
+		s->at = at = __random_between(g, at, p->lifespan - 1);
+		s->duration = __random_between(g, 1, p->lifespan - s->at);
+		p->nr_acquires++;
+	}
+}
+
+static void __print_process(const struct generated_process *p)
+{
+	printf("process %u\n", p->pid);
+	printf("\tstart %u\n", p->starts_at);
+	printf("\tlifespan %u\n", p->lifespan);
+	printf("\tprio %u\n", p->prio);
+	for (unsigned int i = 0; i < p->nr_acquires; i++) {
+		printf("\tacquire %u %u %u\n", p->acquires[i].resource_id, p->acquires[i].at,
+				p->acquires[i].duration);
+	}
+	printf("end\n\n");
+}
+
+static int __print_script(struct generator *g)
+{
+	struct generated_process p;
+
+	__rewind(g);
+	for (unsigned int i = 0; i < g->nr_processes; i++) {
+		__generate(g, &p);
+		__print_process(&p);
+	}
+	return true;
+}
+
+/**
+ * Write the image in two passes over the same random sequence; the process
+ * table first, and then the schedules it refers to. The header is filled at
+ * the end when the number of schedules is known.
+ */
+static int __write_image(struct generator *g, const char *filename)
+{
+	struct workload_header header = {
+		.version = WORKLOAD_VERSION,
+		.nr_processes = g->nr_processes,
+	};
+	struct generated_process p;
+	FILE *file = fopen(filename, "wb");
+
+	if (!file) {
+		fprintf(stderr, "Cannot open %s\n", filename);
+		return false;
+	}
+	memcpy(header.magic, WORKLOAD_MAGIC, sizeof(header.magic));
+	fwrite(&header, sizeof(header), 1, file);
+
+	__rewind(g);
+	for (unsigned int i = 0; i < g->nr_processes; i++) {
+		struct workload_process wp;
+
+		__generate(g, &p);
+		wp = (struct workload_process) {
+			.pid = p.pid,
+			.starts_at = p.starts_at,
+			.lifespan = p.lifespan,
+			.prio = p.prio,
+			.first_schedule = header.nr_schedules,
+			.nr_schedules = p.nr_acquires,
+		};
+		fwrite(&wp, sizeof(wp), 1, file);
+		header.nr_schedules += p.nr_acquires;
+	}
+
+	__rewind(g);
+	for (unsigned int i = 0; i < g->nr_processes; i++) {
+		__generate(g, &p);
+		fwrite(p.acquires, sizeof(*p.acquires), p.nr_acquires, file);
+	}
+
+	rewind(file);
+	fwrite(&header, sizeof(header), 1, file);
+
+	if (fclose(file)) {
+		fprintf(stderr, "Cannot write %s\n", filename);
+		return false;
+	}
+	return true;
+}
+
+static bool __parse_distribution(const char *str, bool arrival, enum distribution *dist)
+{
+	for (unsigned int i = 0; i < sizeof(__distributions) / sizeof(*__distributions); i++) {
+		if (strcmp(str, __distributions[i]) == 0) {
+			if (i == DIST_BURST && !arrival)
+				break;
+			*dist = i;
+			return true;
+		}
+	}
+	fprintf(stderr, "Unknown distribution %s\n", str);
+	return false;
+}
+
+static void __print_usage(char *const name)
+{
+	printf("Usage: %s {-s seed} {-n nr} {-a dist} {-g gap} {-B nr} {-l dist} {-L mean} {-p spread} {-r nr} {-c ratio} {-k nr} {-w image}\n", name);
+	printf("\n");
+	printf("  -s: Seed the generator with @seed (1 by default)\n");
+	printf("  -n: Generate @nr processes (1000 by default)\n");
+	printf("  -a: Arrival distribution; fixed, uniform, exp, or burst (exp by default)\n");
+	printf("  -g: Mean ticks between arrivals (4 by default)\n");
+	printf("  -B: Processes arriving at a time with the burst arrival (16 by default)\n");
+	printf("  -l: Lifespan distribution; fixed, uniform, or exp (exp by default)\n");
+	printf("  -L: Mean lifespan (3 by default)\n");
+	printf("  -p: Spread the priorities over [0, @spread] (%d by default)\n", MAX_PRIO / 2);
+	printf("  -r: Number of resources to contend (none by default)\n");
+	printf("  -c: Ratio of the processes acquiring resources (0.2 by default)\n");
+	printf("  -k: Up to @nr acquisitions per process (2 by default, %d at most)\n",
+			MAX_NR_ACQUIRES);
+	printf("  -w: Write the workload image to @image instead of printing the script\n");
+	printf("\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	struct generator g = {
+		.seed = 1,
+		.nr_processes = 1000,
+		.arrival = DIST_EXP,
+		.arrival_gap = 4,
+		.burst = 16,
+		.lifespan = DIST_EXP,
+		.lifespan_mean = 3,
+		.prio_spread = MAX_PRIO / 2,
+		.nr_resources = 0,
+		.contention = 0.2,
+		.max_acquires = 2,
+	};
+	char *imagefile = NULL;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:n:a:g:B:l:L:p:r:c:k:w:h")) != -1) {
+		switch (opt) {
+		case 's':
+			g.seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'n':
+			g.nr_processes = atoi(optarg);
+			break;
+		case 'a':
+			if (!__parse_distribution(optarg, true, &g.arrival))
+				return EXIT_FAILURE;
+			break;
+		case 'g':
+			g.arrival_gap = atof(optarg);
+			break;
+		case 'B':
+			g.burst = atoi(optarg);
+			break;
+		case 'l':
+			if (!__parse_distribution(optarg, false, &g.lifespan))
+				return EXIT_FAILURE;
+			break;
+		case 'L':
+			g.lifespan_mean = atof(optarg);
+			break;
+		case 'p':
+			g.prio_spread = atoi(optarg);
+			break;
+		case 'r':
+			g.nr_resources = atoi(optarg);
+			break;
+		case 'c':
+			g.contention = atof(optarg);
+			break;
+		case 'k':
+			g.max_acquires = atoi(optarg);
+			break;
+		case 'w':
+			imagefile = optarg;
+			break;
+		case 'h':
+		default:
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (g.arrival_gap < 0 || g.burst < 1 || g.lifespan_mean < 1 ||
+			g.prio_spread > MAX_PRIO || g.contention < 0 || g.contention > 1 ||
+			g.max_acquires < 1 || g.max_acquires > MAX_NR_ACQUIRES) {
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (imagefile)
+		return __write_image(&g, imagefile) ? EXIT_SUCCESS : EXIT_FAILURE;
+	return __print_script(&g) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
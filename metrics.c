@@ -0,0 +1,155 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "metrics.h"
+
+#define METRICS_INITIAL_SLOTS	256
+
+void metrics_init(struct metrics *m)
+{
+	memset(m, 0x00, sizeof(*m));
+}
+
+void metrics_destroy(struct metrics *m)
+{
+	free(m->records);
+	metrics_init(m);
+}
+
+void metrics_add(struct metrics *m, const struct metrics_record *r)
+{
+	if (m->nr_records == m->nr_slots) {
+		unsigned int nr_slots = m->nr_slots ? m->nr_slots * 2 : METRICS_INITIAL_SLOTS;
+		struct metrics_record *records = realloc(m->records, sizeof(*records) * nr_slots);
+		if (!records) {
+			fprintf(stderr, "Out of memory\n");
+			abort();
+		}
+		m->records = records;
+		m->nr_slots = nr_slots;
+	}
+	m->records[m->nr_records++] = *r;
+}
+
+static int __compare_uint(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a;
+	unsigned int y = *(const unsigned int *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * Fill @stat from the @nr values in @values, sorting them in place.
+ * Percentiles are of the nearest rank.
+ */
+static void __summarize_values(unsigned int *values, unsigned int nr, struct metrics_stat *stat)
+{
+	unsigned long long sum = 0;
+
+	memset(stat, 0x00, sizeof(*stat));
+	if (!nr)
+		return;
+
+	for (unsigned int i = 0; i < nr; i++) {
+		sum += values[i];
+	}
+	qsort(values, nr, sizeof(*values), __compare_uint);
+
+	stat->avg = (double)sum / nr;
+	/* The ranks overflow unsigned int beyond some 43M values */
+	stat->p50 = values[((unsigned long long)nr * 50 + 99) / 100 - 1];
+	stat->p99 = values[((unsigned long long)nr * 99 + 99) / 100 - 1];
+}
+
+static inline unsigned int __turnaround(const struct metrics_record *r)
+{
+	return r->exit_at - r->starts_at;
+}
+
+static inline unsigned int __response(const struct metrics_record *r)
+{
+	return r->first_run_at - r->starts_at;
+}
+
+static inline unsigned int __waiting(const struct metrics_record *r)
+{
+	return __turnaround(r) - r->lifespan - r->blocked_ticks;
+}
+
+void metrics_summarize(const struct metrics *m, unsigned int nr_ticks, unsigned int nr_cpus,
+		struct metrics_summary *s)
+{
+	unsigned int *values = malloc(sizeof(*values) * (m->nr_records ? m->nr_records : 1));
+	unsigned long long nr_cpu_ticks = (unsigned long long)nr_ticks * nr_cpus;
+
+	assert(values && "Out of memory");
+
+	s->nr_processes = m->nr_records;
+
+	for (unsigned int i = 0; i < m->nr_records; i++) {
+		values[i] = __turnaround(m->records + i);
+	}
+	__summarize_values(values, m->nr_records, &s->turnaround);
+
+	for (unsigned int i = 0; i < m->nr_records; i++) {
+		values[i] = __response(m->records + i);
+	}
+	__summarize_values(values, m->nr_records, &s->response);
+
+	for (unsigned int i = 0; i < m->nr_records; i++) {
+		values[i] = __waiting(m->records + i);
+	}
+	__summarize_values(values, m->nr_records, &s->waiting);
+
+	s->utilization = nr_cpu_ticks ? m->busy_ticks * 100.0 / nr_cpu_ticks : 0;
+
+	free(values);
+}
+
+void metrics_print(FILE *file, const char *name, const struct metrics *m,
+		const struct metrics_summary *s)
+{
+	fprintf(file, "***** METRICS: %s *****\n", name);
+	fprintf(file, "%5s %7s %7s %7s %10s %8s %8s %8s %9s\n", "pid", "start", "first", "exit",
+			"turnaround", "response", "waiting", "blocked", "preempted");
+
+	for (unsigned int i = 0; i < m->nr_records; i++) {
+		const struct metrics_record *r = m->records + i;
+
+		fprintf(file, "%5u %7u %7u %7u %10u %8u %8u %8u %9u\n", r->pid, r->starts_at,
+				r->first_run_at, r->exit_at, __turnaround(r), __response(r), __waiting(r),
+				r->blocked_ticks, r->nr_preemptions);
+	}
+
+	fprintf(file, "\n");
+	fprintf(file, "%-12s %10s %8s %8s\n", "", "avg", "p50", "p99");
+	fprintf(file, "%-12s %10.2f %8u %8u\n", "Turnaround",
+			s->turnaround.avg, s->turnaround.p50, s->turnaround.p99);
+	fprintf(file, "%-12s %10.2f %8u %8u\n", "Response",
+			s->response.avg, s->response.p50, s->response.p99);
+	fprintf(file, "%-12s %10.2f %8u %8u\n", "Waiting",
+			s->waiting.avg, s->waiting.p50, s->waiting.p99);
+	fprintf(file, "\n");
+	fprintf(file, "Processes: %u, CPU utilization: %.2f%%, Idle ticks: %llu, Context switches: %llu, "
+			"Inversion ticks: %llu\n", s->nr_processes, s->utilization, m->idle_ticks,
+			m->nr_context_switches, m->inversion_ticks);
+	fprintf(file, "\n");
+}
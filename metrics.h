@@ -0,0 +1,89 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/***********************************************************************
+ * Scheduling metrics
+ *
+ * DESCRIPTION
+ *   The simulator stamps each process with a few ticks as it goes (see the
+ *   metrics fields in struct process) and files a struct metrics_record when
+ *   the process exits. Everything else is derived from the records when the
+ *   simulation is over, so the recording costs a handful of stores per event.
+ *
+ *   turnaround = @exit_at - @starts_at
+ *   response   = @first_run_at - @starts_at
+ *   waiting    = turnaround - @lifespan - @blocked_ticks; ticks spent ready
+ */
+struct metrics_record {
+	unsigned int pid;
+	unsigned int starts_at;
+	unsigned int lifespan;
+	unsigned int first_run_at;		/* The first tick the process ran in */
+	unsigned int exit_at;			/* The tick the process exited in */
+	unsigned int blocked_ticks;		/* # of ticks the process waited for resources */
+	unsigned int nr_preemptions;	/* # of times the process was switched out
+									   while it could still run */
+};
+
+struct metrics {
+	struct metrics_record *records;	/* Records of the exited processes */
+	unsigned int nr_records;
+	unsigned int nr_slots;
+
+	unsigned long long busy_ticks;	/* # of CPU ticks in which a process ran */
+	unsigned long long idle_ticks;	/* # of CPU ticks in which no process ran */
+	unsigned long long nr_context_switches;
+	unsigned long long inversion_ticks;
+									/* Waiter-ticks spent on lower-priority owners */
+};
+
+struct metrics_stat {
+	double avg;
+	unsigned int p50;
+	unsigned int p99;
+};
+
+struct metrics_summary {
+	unsigned int nr_processes;
+	struct metrics_stat turnaround;
+	struct metrics_stat response;
+	struct metrics_stat waiting;
+	double utilization;				/* @busy_ticks over all the CPU ticks, in % */
+};
+
+void metrics_init(struct metrics *m);
+void metrics_destroy(struct metrics *m);
+
+void metrics_add(struct metrics *m, const struct metrics_record *r);
+
+/**
+ * Summarize @m of a simulation that ran for @nr_ticks on @nr_cpus CPUs
+ */
+void metrics_summarize(const struct metrics *m, unsigned int nr_ticks, unsigned int nr_cpus,
+		struct metrics_summary *s);
+
+/**
+ * Print the table of the processes in @m and the summary @s of @name to @file
+ */
+void metrics_print(FILE *file, const char *name, const struct metrics *m,
+		const struct metrics_summary *s);
+
+#endif
@@ -19,28 +19,19 @@
 #include <assert.h>
 
 #include "list_head.h"
-
-/**
- * The process which is currently running
- */
 #include "process.h"
-extern struct process *current;
-
-/**
- * List head to hold the processes ready to run
- */
-extern struct list_head readyqueue;
-
-/**
- * Resources in the system.
- */
 #include "resource.h"
-extern struct resource resources[NR_RESOURCES];
 
 /**
- * Monotonically increasing ticks. Do not modify it
+ * The state of the simulation running on this thread. sim.h defines
+ *
+ *   struct process *current: The process which is currently running
+ *   struct list_head readyqueue: List head to hold the processes ready to run
+ *   struct resource resources[NR_RESOURCES]: Resources in the system
+ *   NR_RESOURCES: The number of resources, which is set when the script is loaded
+ *   unsigned int ticks: Monotonically increasing ticks. Do not modify it
  */
-extern unsigned int ticks;
+#include "sim.h"
 
 /**
  * Quiet mode. True if the program was started with -q option
@@ -132,6 +123,55 @@ static void fcfs_release(int resource_id)
 }
 
 #include "sched.h"
+#include "prioq.h"
+
+/***********************************************************************
+ * Multi-level ready queue shared by the priority-based schedulers
+ *
+ * DESCRIPTION
+ *   The framework and the release functions keep putting ready processes
+ *   into @readyqueue. The priority-based schedulers move them over to
+ *   @prio_readyqueue at every schedule() in the arrival order, so that the
+ *   next process is picked without scanning all the ready processes.
+ *   Each CPU of each simulation has its own one in @sched_data.
+ ***********************************************************************/
+#define prio_readyqueue (*(struct prioq *)sched_data)
+
+static int prio_initialize(void)
+{
+	sched_data = malloc(sizeof(struct prioq));
+	if (!sched_data)
+		return -1;
+
+	prioq_init(&prio_readyqueue);
+	return 0;
+}
+
+static void prio_finalize(void)
+{
+	free(sched_data);
+	sched_data = NULL;
+}
+
+static void prio_checkpoint(struct checkpoint *c)
+{
+	prioq_checkpoint(&prio_readyqueue, c);
+}
+
+static int prio_restore(struct checkpoint *c)
+{
+	return prioq_restore(&prio_readyqueue, c) ? 0 : -1;
+}
+
+/**
+ * Hand over the first process with the highest priority on this CPU to
+ * another CPU running out of processes
+ */
+static struct process *prio_steal(void)
+{
+	prioq_splice_tail_init(&prio_readyqueue, &readyqueue);
+	return prioq_pop(&prio_readyqueue);
+}
 
 /***********************************************************************
  * FCFS scheduler
@@ -193,8 +233,9 @@ pick_next:
 	return next;
 }
 
-struct scheduler fcfs_scheduler = {
+const struct scheduler fcfs_scheduler = {
 	.name = "FCFS",
+	.nonpreemptive = true,
 	.acquire = fcfs_acquire,
 	.release = fcfs_release,
 	.initialize = fcfs_initialize,
@@ -202,6 +243,56 @@ struct scheduler fcfs_scheduler = {
 	.schedule = fcfs_schedule,
 };
 
+/***********************************************************************
+ * Array-backed ready queue shared by SJF and STCF
+ *
+ * DESCRIPTION
+ *   SJF and STCF look through all the ready processes for the shortest one
+ *   at every schedule(). They move the processes from @readyqueue over to
+ *   @shortest_readyqueue in the arrival order, which keeps their lifespans
+ *   and remaining times in arrays to scan with SIMD. See arrayq.h.
+ ***********************************************************************/
+#include "arrayq.h"
+
+#define shortest_readyqueue (*(struct arrayq *)sched_data)
+
+static int shortest_initialize(void)
+{
+	sched_data = malloc(sizeof(struct arrayq));
+	if (!sched_data)
+		return -1;
+
+	arrayq_init(&shortest_readyqueue);
+	return 0;
+}
+
+static void shortest_finalize(void)
+{
+	arrayq_destroy(&shortest_readyqueue);
+	free(sched_data);
+	sched_data = NULL;
+}
+
+static void shortest_checkpoint(struct checkpoint *c)
+{
+	arrayq_checkpoint(&shortest_readyqueue, c);
+}
+
+static int shortest_restore(struct checkpoint *c)
+{
+	return arrayq_restore(&shortest_readyqueue, c) ? 0 : -1;
+}
+
+/**
+ * Hand over the first ready process, as the framework does for the
+ * schedulers without steal()
+ */
+static struct process *shortest_steal(void)
+{
+	arrayq_splice_tail_init(&shortest_readyqueue, &readyqueue);
+	return arrayq_pop(&shortest_readyqueue);
+}
+
 /***********************************************************************
  * SJF scheduler
  ***********************************************************************/
@@ -211,7 +302,9 @@ static struct process *sjf_schedule(void)
 	 * Implement your own SJF scheduler here.
 	 */
 	struct process *next = NULL;
-	struct process *compare = NULL;
+
+	arrayq_splice_tail_init(&shortest_readyqueue, &readyqueue);
+
 	/* You may inspect the situation by calling dump_status() at any time */
 	// dump_status();
 
@@ -236,36 +329,26 @@ static struct process *sjf_schedule(void)
 pick_next:
 	/* Let's pick a new process to run next */
 
-	if (!list_empty(&readyqueue))
-	{
-		/**
-		 * If the ready queue is not empty, pick the first process
-		 * in the ready queue
-		 */
-		next = list_first_entry(&readyqueue, struct process, list);
-		list_for_each_entry(compare, &readyqueue, list)
-		{
-			if (compare->lifespan < next->lifespan)
-			{
-				next = compare;
-			}
-		}
-		/**
-		 * Detach the process from the ready queue. Note that we use
-		 * list_del_init() over list_del() to maintain the list head tidy.
-		 * Otherwise, the framework will complain (assert) on process exit.
-		 */
-		list_del_init(&next->list);
-	}
+	/**
+	 * Pick the first process with the shortest lifespan, and detach it
+	 * from the ready queue
+	 */
+	next = arrayq_pop_shortest(&shortest_readyqueue);
 
 	/* Return the process to run next */
 	return next;
 }
 
-struct scheduler sjf_scheduler = {
+const struct scheduler sjf_scheduler = {
 	.name = "Shortest-Job First",
+	.nonpreemptive = true,
 	.acquire = fcfs_acquire,  /* Use the default FCFS acquire() */
 	.release = fcfs_release,  /* Use the default FCFS release() */
+	.initialize = shortest_initialize,
+	.finalize = shortest_finalize,
+	.steal = shortest_steal,
+	.checkpoint = shortest_checkpoint,
+	.restore = shortest_restore,
 	.schedule = sjf_schedule, /* TODO: Assign your schedule function
 							  to this function pointer to activate
 							  SJF in the simulation system */
@@ -281,7 +364,9 @@ static struct process *stcf_schedule(void)
 	 * Implement your own SJF scheduler here.
 	 */
 	struct process *next = NULL;
-	struct process *tmp = NULL;
+
+	arrayq_splice_tail_init(&shortest_readyqueue, &readyqueue);
+
 	// preemptive하다, 나보다 더 짧은 순간이 오면 그애를 pick한다.
 	if (!current || current->status == PROCESS_BLOCKED)
 	{
@@ -290,42 +375,32 @@ static struct process *stcf_schedule(void)
 
 	if (current->age < current->lifespan)
 	{
-		list_for_each_entry(tmp, &readyqueue, list)
+		/* The first one in the queue to complete earlier than current */
+		next = arrayq_pop_first_below(&shortest_readyqueue, current->lifespan - current->age);
+		if (next)
 		{
-			if ((current->lifespan - current->age) > (tmp->lifespan - tmp->age))
-			{
-				next = tmp;
-				next->status = PROCESS_READY;
-				list_add(&current->list, &readyqueue);
-				current->status = PROCESS_BLOCKED;
-				current = next;
-				list_del_init(&next->list);
-				break;
-			}
+			next->status = PROCESS_READY;
+			arrayq_add(&shortest_readyqueue, current);
+			current->status = PROCESS_BLOCKED;
+			current = next;
 		}
 		return current;
 	}
 
 pick_next:
-	if (!list_empty(&readyqueue))
-	{
-		next = list_first_entry(&readyqueue, struct process, list);
-		list_for_each_entry(tmp, &readyqueue, list)
-		{
-			if (tmp->lifespan < next->lifespan)
-			{
-				next = tmp;
-			}
-		}
-		list_del_init(&next->list);
-	}
+	next = arrayq_pop_shortest(&shortest_readyqueue);
 
 	return next;
 }
-struct scheduler stcf_scheduler = {
+const struct scheduler stcf_scheduler = {
 	.name = "Shortest Time-to-Complete First",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
+	.initialize = shortest_initialize,
+	.finalize = shortest_finalize,
+	.steal = shortest_steal,
+	.checkpoint = shortest_checkpoint,
+	.restore = shortest_restore,
 
 	/* You need to check the newly created processes to implement STCF.
 	 * Have a look at @forked() callback.
@@ -368,7 +443,7 @@ pick_next:
 
 	return next;
 }
-struct scheduler rr_scheduler = {
+const struct scheduler rr_scheduler = {
 	.name = "Round-Robin",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
@@ -391,30 +466,22 @@ static bool prio_acquire(int resource_id) // process가 resource를 차지하겠
 	// blocked상태는 waitqueue로 들어가는 과정이다. 현재 process가 blocked상태로 들어가고
 	current->status = PROCESS_BLOCKED;
 	// currentprocess를 waitqueue에 넣어 놓는다.
-	list_add_tail(&current->list, &r->waitqueue);
+	prioq_add_tail(resource_prio_waitqueue(r), current);
 	return false;
 }
 
 static void prio_release(int resource_id)
 {
 	struct resource *r = resources + resource_id;
-	struct process *tmp = NULL;
 	assert(r->owner == current);
 	r->owner = NULL;
-	if (!list_empty(&r->waitqueue))
+	if (r->prio_waitqueue && !prioq_empty(r->prio_waitqueue))
 	{
-		struct process *waiter = list_first_entry(&r->waitqueue, struct process, list);
-		list_for_each_entry(tmp, &r->waitqueue, list)
-		{
-			if (tmp->prio > waiter->prio)
-			{
-				waiter = tmp;
-			}
-		}
+		// 가장 prio가 높은 waiter 중 먼저 기다린 것을 꺼낸다
+		struct process *waiter = prioq_pop(r->prio_waitqueue);
 
 		// process의 resource가 있으면 waitqueue에 들어가서 기다려야 된다?
 		assert(waiter->status == PROCESS_BLOCKED);
-		list_del_init(&waiter->list);
 		waiter->status = PROCESS_READY;
 		list_add_tail(&waiter->list, &readyqueue);
 	}
@@ -422,7 +489,8 @@ static void prio_release(int resource_id)
 static struct process *prio_schedule(void)
 {
 	struct process *next = NULL;
-	struct process *tmp = NULL;
+
+	prioq_splice_tail_init(&prio_readyqueue, &readyqueue);
 
 	/* You may inspect the situation by calling dump_status() at any time */
 	// dump_status();
@@ -435,42 +503,23 @@ static struct process *prio_schedule(void)
 
 	if (current->age < current->lifespan)
 	{
-		list_for_each_entry(tmp, &readyqueue, list)
+		if (!prioq_empty(&prio_readyqueue))
 		{
-			if (current->pid != tmp->pid)
-			{
-				list_add(&current->list, &readyqueue);
-				goto pick_next;
-			}
-			else
-			{
-				list_del_init(&current->list);
-			}
+			/* current는 같은 prio 중에서 맨 앞에 선다. */
+			prioq_add(&prio_readyqueue, current);
+			goto pick_next;
 		}
 		return current;
 	}
 
 pick_next:
 	// readyqueue에서 scheduleing을 해준 후 process를 선택한다.
-	if (!list_empty(&readyqueue))
-	{
-		next = list_first_entry(&readyqueue, struct process, list);
-
-		list_for_each_entry(tmp, &readyqueue, list)
-		{
-
-			if (tmp->prio > next->prio)
-			{
-				next = tmp;
-			}
-		}
-		list_del_init(&next->list);
-	}
+	next = prioq_pop(&prio_readyqueue);
 
 	return next;
 }
 
-struct scheduler prio_scheduler = {
+const struct scheduler prio_scheduler = {
 	.name = "Priority",
 	/**
 	 * Implement your own acqure/release function to make the priority
@@ -478,6 +527,11 @@ struct scheduler prio_scheduler = {
 	 */
 	.acquire = prio_acquire,
 	.release = prio_release,
+	.initialize = prio_initialize,
+	.finalize = prio_finalize,
+	.steal = prio_steal,
+	.checkpoint = prio_checkpoint,
+	.restore = prio_restore,
 	/* Implement your own prio_schedule() and attach it here */
 	.schedule = prio_schedule,
 };
@@ -485,6 +539,47 @@ struct scheduler prio_scheduler = {
 /***********************************************************************
  * Priority scheduler with aging
  ***********************************************************************/
+#include "agingq.h"
+
+/**
+ * Ready queue that ages the processes in it lazily, so aging them all at
+ * every tick is an O(1) bump of its epoch. See agingq.h
+ */
+#define pa_readyqueue (*(struct agingq *)sched_data)
+
+static int pa_initialize(void)
+{
+	sched_data = malloc(sizeof(struct agingq));
+	if (!sched_data)
+		return -1;
+
+	agingq_init(&pa_readyqueue);
+	return 0;
+}
+
+static void pa_finalize(void)
+{
+	agingq_destroy(&pa_readyqueue);
+	free(sched_data);
+	sched_data = NULL;
+}
+
+static void pa_checkpoint(struct checkpoint *c)
+{
+	agingq_checkpoint(&pa_readyqueue, c);
+}
+
+static int pa_restore(struct checkpoint *c)
+{
+	return agingq_restore(&pa_readyqueue, c) ? 0 : -1;
+}
+
+static struct process *pa_steal(void)
+{
+	agingq_splice_tail_init(&pa_readyqueue, &readyqueue);
+	return agingq_pop(&pa_readyqueue);
+}
+
 static bool pa_acquire(int resource_id) // process가 resource를 차지하겠다 내놔라!!!ㄴ
 {
 	struct resource *r = resources + resource_id; // reource_id는 1~16까지 아무거나
@@ -498,29 +593,21 @@ static bool pa_acquire(int resource_id) // process가 resource를 차지하겠
 	// blocked상태는 waitqueue로 들어가는 과정이다. 현재 process가 blocked상태로 들어가고
 	current->status = PROCESS_BLOCKED;
 	// currentprocess를 waitqueue에 넣어 놓는다.
-	list_add_tail(&current->list, &r->waitqueue);
+	prioq_add_tail(resource_prio_waitqueue(r), current);
 	return false;
 }
 
 static void pa_release(int resource_id)
 {
 	struct resource *r = resources + resource_id;
-	struct process *tmp = NULL;
 	assert(r->owner == current);
 	r->owner = NULL;
-	if (!list_empty(&r->waitqueue))
+	if (r->prio_waitqueue && !prioq_empty(r->prio_waitqueue))
 	{
-		struct process *waiter = list_first_entry(&r->waitqueue, struct process, list);
-		list_for_each_entry(tmp, &r->waitqueue, list)
-		{
-			if (tmp->prio > waiter->prio)
-			{
-				waiter = tmp;
-			}
-		}
+		// 가장 prio가 높은 waiter 중 먼저 기다린 것을 꺼낸다
+		struct process *waiter = prioq_pop(r->prio_waitqueue);
 		// process의 resource가 있으면 waitqueue에 들어가서 기다려야 된다?
 		assert(waiter->status == PROCESS_BLOCKED);
-		list_del_init(&waiter->list);
 		waiter->status = PROCESS_READY;
 		list_add_tail(&waiter->list, &readyqueue);
 	}
@@ -532,9 +619,10 @@ static struct process *pa_schedule(void)
 	 * Implement your own SJF scheduler here.
 	 */
 	struct process *next = NULL;
-	struct process *tmp = NULL;
 	// int a = 0;
 
+	agingq_splice_tail_init(&pa_readyqueue, &readyqueue);
+
 	/* You may inspect the situation by calling dump_status() at any time */
 	// dump_status();
 	// pa는 preemptive 하다, policy는 rr기반 스케줄될때마다(실행될때마다) 다른 프로세스 다시 readyqueue에 넣기
@@ -549,52 +637,40 @@ static struct process *pa_schedule(void)
 	if (current)
 	{
 		// readyqueue에는 current process를 제외하고 다른 Process들이 존재한다. 따라서 tmp를 올려주면 current를 제외한 process들의 prio 증가
-		list_for_each_entry(tmp, &readyqueue, list)
-		{
-			// printf("be +1:%d %d\n",tmp->pid,tmp->prio);
-			tmp->prio++;
-
-			// readyqueue에는 current process가 존재하지않는다.
-		}
+		agingq_age(&pa_readyqueue);
+		// readyqueue에는 current process가 존재하지않는다.
 		// printf("current:%d\n",current->pid);
 	}
 
 	if (current->age < current->lifespan) // current가 끝날때 까지 돌아라
 	{
-		list_move_tail(&current->list, &readyqueue); // 현재거를 뒤로 옮기고 -> rr방식
-		goto pick_next;								 // 다음거를 집어라
+		agingq_add_tail(&pa_readyqueue, current); // 현재거를 뒤로 옮기고 -> rr방식
+		goto pick_next;							   // 다음거를 집어라
 	}
 
 pick_next:
-
-	if (!list_empty(&readyqueue))
+	// prio가 높은게 뽑히게 해라 같은 prio가 나오면-> ex) 20 20 next = 먼저reayqueue에 존재하는게 나온다
+	// rr정책을 사용해서 최근에 사용된 process는 readyqueue마지막에 붙어있다.
+	next = agingq_pop(&pa_readyqueue);
+	if (next)
 	{
-		next = list_first_entry(&readyqueue, struct process, list);
-		// printf("nextpid prio: %d %d\n",next->pid,next->prio);
-		list_for_each_entry(tmp, &readyqueue, list)
-		{
-			// printf("af +1 tmppid prio: %d %d\n",tmp->pid,tmp->prio);
-			if (tmp->prio > next->prio)
-			// prio가 높은게 뽑히게 해라 같은 prio가 나오면-> ex) 20 20 next = 먼저reayqueue에 존재하는게 나온다
-			// rr정책을 사용해서 최근에 사용된 process는 readyqueue마지막에 붙어있다.
-			{
-				// printf("tmp pid prio: %d %d\n",tmp->pid,tmp->prio);
-				next = tmp;
-			}
-		}
 		next->prio = next->prio_orig; // next로 뽑힌 prio를 prio_orig로 만들어준다.
-		list_del_init(&next->list);
 	}
 
 	return next;
 }
-struct scheduler pa_scheduler = {
+const struct scheduler pa_scheduler = {
 	.name = "Priority + aging",
 	/**
 	 * Ditto
 	 */
 	.acquire = pa_acquire,
 	.release = pa_release,
+	.initialize = pa_initialize,
+	.finalize = pa_finalize,
+	.steal = pa_steal,
+	.checkpoint = pa_checkpoint,
+	.restore = pa_restore,
 	.schedule = pa_schedule,
 };
 
@@ -613,14 +689,13 @@ static bool pcp_acquire(int resource_id) // process가 resource를 차지하겠
 	}
 
 	current->status = PROCESS_BLOCKED;
-	list_add_tail(&current->list, &r->waitqueue);
+	prioq_add_tail(resource_prio_waitqueue(r), current);
 	return false;
 }
 
 static void pcp_release(int resource_id)
 {
 	struct resource *r = resources + resource_id;
-	struct process *tmp = NULL;
 	assert(r->owner == current);
 
 	current->prio = current->prio_orig; // release를 빠져나올때 current를 origin으로 바꿔준다.
@@ -628,21 +703,14 @@ static void pcp_release(int resource_id)
 	// printf("rowner pid prio: %d %d\n",r->owner->pid,current->prio);
 	r->owner = NULL;
 
-	if (!list_empty(&r->waitqueue))
+	if (r->prio_waitqueue && !prioq_empty(r->prio_waitqueue))
 	{
-		struct process *waiter = list_first_entry(&r->waitqueue, struct process, list);
-		list_for_each_entry(tmp, &r->waitqueue, list)
-		{
-			if (tmp->prio > waiter->prio)
-			{
-				waiter = tmp;
-			}
-		}
+		// 가장 prio가 높은 waiter 중 먼저 기다린 것을 꺼낸다
+		struct process *waiter = prioq_pop(r->prio_waitqueue);
 		// process의 resource가 있으면 waitqueue에 들어가서 기다려야 된다?
 		assert(waiter->status == PROCESS_BLOCKED);
 		// printf("realase rowner prio:%d\n",r->owner->prio);
 
-		list_del_init(&waiter->list);
 		waiter->status = PROCESS_READY;
 
 		list_add_tail(&waiter->list, &readyqueue);
@@ -655,9 +723,10 @@ static struct process *pcp_schedule(void)
 	 * Implement your own SJF scheduler here.
 	 */
 	struct process *next = NULL;
-	struct process *tmp = NULL;
 	// int a = 0;
 
+	prioq_splice_tail_init(&prio_readyqueue, &readyqueue);
+
 	/* You may inspect the situation by calling dump_status() at any time */
 	// dump_status();
 	// pcp는 preemptive 하다, policy는 rr기반 + prio를 max_prio까지 올려준다. 스케줄될때마다(실행될때마다) 다른 프로세스 다시 readyqueue에 넣기 -> 꼬리에 넣는다.
@@ -670,96 +739,111 @@ static struct process *pcp_schedule(void)
 
 	if (current->age < current->lifespan) // current가 끝날때 까지 돌아라
 	{
-		list_move_tail(&current->list, &readyqueue);
+		prioq_add_tail(&prio_readyqueue, current);
 		goto pick_next;
 	}
 
 pick_next:
-
-	if (!list_empty(&readyqueue))
-	{
-		next = list_first_entry(&readyqueue, struct process, list);
-		list_for_each_entry(tmp, &readyqueue, list)
-		{
-			if (tmp->prio > next->prio)
-			{
-				next = tmp;
-			}
-		}
-		list_del_init(&next->list);
-	}
+	next = prioq_pop(&prio_readyqueue);
 
 	return next;
 }
-struct scheduler pcp_scheduler = {
+const struct scheduler pcp_scheduler = {
 	.name = "Priority + PCP Protocol",
 	/**
 	 * Ditto
 	 */
 	.acquire = pcp_acquire,
 	.release = pcp_release,
+	.initialize = prio_initialize,
+	.finalize = prio_finalize,
+	.steal = prio_steal,
+	.checkpoint = prio_checkpoint,
+	.restore = prio_restore,
 	.schedule = pcp_schedule,
 };
 
 /***********************************************************************
  * Priority scheduler with priority inheritance protocol
  ***********************************************************************/
+/**
+ * Bring @p->prio up to max(@p->prio_orig, the highest priority among the
+ * waiters of the resources @p holds), and carry the change over to the
+ * processes down the blocking chain; @p may be waiting for a resource whose
+ * owner is waiting for another resource, and so on. The walk stops as soon as
+ * a process keeps its priority. Every process in the chain holds a resource
+ * the previous one is waiting for, so a chain without a cycle cannot be longer
+ * than NR_RESOURCES. Deadlocked cycles are cut there as well.
+ */
+static void pip_refresh(struct process *p)
+{
+	for (unsigned int depth = 0; p && depth <= NR_RESOURCES; depth++) {
+		unsigned int prio = p->prio_orig;
+		struct resource *r;
+
+		list_for_each_entry(r, &p->holding, held) {
+			struct process *top = r->prio_waitqueue ? prioq_peek(r->prio_waitqueue) : NULL;
+
+			if (top && top->prio > prio)
+				prio = top->prio;
+		}
+
+		if (prio == p->prio)
+			break;
+		p->prio = prio;
+
+		/* Reposition @p in the ready queue or the waitqueue it is in */
+		if (prioq_of(p))
+			prioq_update(prioq_of(p), p);
+
+		p = p->blocked_on ? p->blocked_on->owner : NULL;
+	}
+}
+
 static bool pip_acquire(int resource_id) // process가 resource를 차지하겠다 내놔라!!!ㄴ
 {
 	struct resource *r = resources + resource_id; // reource_id는 1~16까지 아무거나
 
-	struct process *tmp = NULL;
-	
 	if (!r->owner)
-	{	
+	{
 		r->owner = current;
-		
+		list_add_tail(&r->held, &current->holding);
+		// 이미 기다리고 있는 waiter가 있을 수 있으니 prio를 다시 계산한다
+		pip_refresh(current);
 		return true;
 	}
-	
 
 	current->status = PROCESS_BLOCKED;
-	list_add_tail(&current->list, &r->waitqueue);
-	// printf("rower: %d %d current : %d %d\n",r->owner->pid,r->owner->prio,current->pid,current->prio);
-	list_for_each_entry(tmp,&r->waitqueue,list){
-			// printf("before waitqueue: %d %d\n",tmp->pid,tmp->prio);
-			r->owner->prio += current->prio;
-		}
+	current->blocked_on = r;
+	prioq_add_tail(resource_prio_waitqueue(r), current);
+	// owner부터 blocking chain을 따라가며 prio를 물려준다
+	pip_refresh(r->owner);
 	return false;
 }
 
 static void pip_release(int resource_id)
 {
 	struct resource *r = resources + resource_id;
-	struct process *tmp = NULL;
 	assert(r->owner == current);
 
-	current->prio = current->prio_orig; // release를 빠져나올때 current를 origin으로 바꿔준다.
-	// printf("currentpid prio: %d %d\n",current->pid,current->prio);
-	// printf("rowner pid prio: %d %d\n",r->owner->pid,current->prio);
 	r->owner = NULL;
+	list_del_init(&r->held);
 
-	if (!list_empty(&r->waitqueue))
+	if (r->prio_waitqueue && !prioq_empty(r->prio_waitqueue))
 	{
-		struct process *waiter = list_first_entry(&r->waitqueue, struct process, list);
-		list_for_each_entry(tmp, &r->waitqueue, list)
-		{	
-			
-
-			if (tmp->prio > waiter->prio)
-			{
-				waiter = tmp;
-			}
-		}
+		// 가장 prio가 높은 waiter 중 먼저 기다린 것을 꺼낸다
+		struct process *waiter = prioq_pop(r->prio_waitqueue);
 		// process의 resource가 있으면 waitqueue에 들어가서 기다려야 된다?
 		assert(waiter->status == PROCESS_BLOCKED);
-		// printf("realase rowner prio:%d\n",r->owner->prio);
 
-		list_del_init(&waiter->list);
+		waiter->blocked_on = NULL;
 		waiter->status = PROCESS_READY;
 
 		list_add_tail(&waiter->list, &readyqueue);
 	}
+
+	// 아직 잡고 있는 resource의 waiter들만 보고 prio를 다시 계산한다
+	pip_refresh(current);
 }
 
 static struct process *pip_schedule(void)
@@ -768,9 +852,10 @@ static struct process *pip_schedule(void)
 	 * Implement your own SJF scheduler here.
 	 */
 	struct process *next = NULL;
-	struct process *tmp = NULL;
 	// int a = 0;
 
+	prioq_splice_tail_init(&prio_readyqueue, &readyqueue);
+
 	/* You may inspect the situation by calling dump_status() at any time */
 	// dump_status();
 	// pip는 preemptive 하다, policy는 rr기반 + prio를 원래 수준으로 유지하다가 현재 Process보다 높은
@@ -784,37 +869,498 @@ static struct process *pip_schedule(void)
 
 	if (current->age < current->lifespan) // current가 끝날때 까지 돌아라
 	{
-		list_move_tail(&current->list, &readyqueue);
+		prioq_add_tail(&prio_readyqueue, current);
 		goto pick_next;
 	}
 
 pick_next:
-
-	if (!list_empty(&readyqueue))
-	{
-		next = list_first_entry(&readyqueue, struct process, list);
-		list_for_each_entry(tmp, &readyqueue, list)
-		{
-			if (tmp->prio > next->prio)
-			{
-				next = tmp;
-			}
-			
-		}
-		list_del_init(&next->list);
-		
-	}
+	next = prioq_pop(&prio_readyqueue);
 
 	return next;
 }
-struct scheduler pip_scheduler = {
+const struct scheduler pip_scheduler = {
 	.name = "Priority + PIP Protocol",
 	/**
 	 * Ditto
 	 */
 	.acquire = pip_acquire,
 	.release = pip_release,
+	.initialize = prio_initialize,
+	.finalize = prio_finalize,
+	.steal = prio_steal,
+	.checkpoint = prio_checkpoint,
+	.restore = prio_restore,
 	.schedule = pip_schedule,
 
 
 };
+
+/***********************************************************************
+ * Proportional-share schedulers
+ *
+ * DESCRIPTION
+ *   The stride and the CFS-like schedulers share the CPU among the ready
+ *   processes in proportion to their weights. A process advances its
+ *   virtual time by FAIR_STRIDE1 / weight for every tick it runs, and the
+ *   one with the smallest virtual time runs next out of fairq in O(log n).
+ *   The weight of priority n is that of nice 19 - n in Linux, so each step
+ *   of priority is worth about 25% more CPU, up to priority 39.
+ ***********************************************************************/
+#include "checkpoint.h"
+#include "fairq.h"
+
+#define FAIR_STRIDE1	(1 << 24)
+
+static const unsigned int fair_weights[] = {
+	/* nice 19 to 10 */
+	15, 18, 23, 29, 36, 45, 56, 70, 87, 110,
+	/* nice 9 to 0 */
+	137, 172, 215, 272, 335, 423, 526, 655, 820, 1024,
+	/* nice -1 to -10 */
+	1277, 1586, 1991, 2501, 3121, 3906, 4904, 6100, 7620, 9548,
+	/* nice -11 to -20 */
+	11916, 14949, 18705, 23254, 29154, 36291, 46273, 56483, 71755, 88761,
+};
+
+#define NR_FAIR_WEIGHTS	(sizeof(fair_weights) / sizeof(*fair_weights))
+
+static inline unsigned int fair_weight(struct process *p)
+{
+	return fair_weights[p->prio < NR_FAIR_WEIGHTS ? p->prio : NR_FAIR_WEIGHTS - 1];
+}
+
+/**
+ * Charge @p for the tick it has just run
+ */
+static inline void fair_charge(struct process *p)
+{
+	p->__fairq_key += FAIR_STRIDE1 / fair_weight(p);
+}
+
+/**
+ * Whether @current ran in the previous tick and still has something to run
+ */
+static inline bool fair_current_runnable(void)
+{
+	return current && current->status != PROCESS_BLOCKED && current->age < current->lifespan;
+}
+
+/***********************************************************************
+ * Stride scheduler
+ *
+ * DESCRIPTION
+ *   Run the process with the smallest pass for a tick at a time. The pass
+ *   is the virtual time in fairq, and the stride is FAIR_STRIDE1 / weight.
+ ***********************************************************************/
+#define fair_readyqueue (*(struct fairq *)sched_data)
+
+static int stride_initialize(void)
+{
+	sched_data = malloc(sizeof(struct fairq));
+	if (!sched_data)
+		return -1;
+
+	fairq_init(&fair_readyqueue);
+	return 0;
+}
+
+static void stride_finalize(void)
+{
+	fairq_destroy(&fair_readyqueue);
+	free(sched_data);
+	sched_data = NULL;
+}
+
+static void stride_checkpoint(struct checkpoint *c)
+{
+	fairq_checkpoint(&fair_readyqueue, c);
+}
+
+static int stride_restore(struct checkpoint *c)
+{
+	return fairq_restore(&fair_readyqueue, c) ? 0 : -1;
+}
+
+static struct process *stride_steal(void)
+{
+	fairq_splice_tail_init(&fair_readyqueue, &readyqueue);
+	return fairq_pop(&fair_readyqueue);
+}
+
+static struct process *stride_schedule(void)
+{
+	fairq_splice_tail_init(&fair_readyqueue, &readyqueue);
+
+	if (fair_current_runnable()) {
+		fair_charge(current);
+		fairq_add_tail(&fair_readyqueue, current);
+	}
+
+	return fairq_pop(&fair_readyqueue);
+}
+
+const struct scheduler stride_scheduler = {
+	.name = "Stride",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.initialize = stride_initialize,
+	.finalize = stride_finalize,
+	.steal = stride_steal,
+	.checkpoint = stride_checkpoint,
+	.restore = stride_restore,
+	.schedule = stride_schedule,
+};
+
+/***********************************************************************
+ * CFS-like scheduler
+ *
+ * DESCRIPTION
+ *   Run the process with the smallest vruntime for its slice of
+ *   CFS_LATENCY ticks, which is shared among the processes on the CPU in
+ *   proportion to their weights but is no shorter than CFS_MIN_SLICE. The
+ *   process is charged for every tick it runs, and is preempted only at the
+ *   end of its slice.
+ ***********************************************************************/
+#define CFS_LATENCY		12
+#define CFS_MIN_SLICE	2
+
+struct cfs_rq {
+	struct fairq queue;
+	unsigned long long total_weight;	/* Weight of the processes in @queue */
+	unsigned int slice;					/* Ticks left for @current to run */
+};
+
+#define cfs_runqueue (*(struct cfs_rq *)sched_data)
+
+static int cfs_initialize(void)
+{
+	sched_data = malloc(sizeof(struct cfs_rq));
+	if (!sched_data)
+		return -1;
+
+	fairq_init(&cfs_runqueue.queue);
+	cfs_runqueue.total_weight = 0;
+	cfs_runqueue.slice = 0;
+	return 0;
+}
+
+static void cfs_finalize(void)
+{
+	fairq_destroy(&cfs_runqueue.queue);
+	free(sched_data);
+	sched_data = NULL;
+}
+
+static void cfs_enqueue(struct process *p)
+{
+	cfs_runqueue.total_weight += fair_weight(p);
+	fairq_add_tail(&cfs_runqueue.queue, p);
+}
+
+static struct process *cfs_dequeue(void)
+{
+	struct process *p = fairq_pop(&cfs_runqueue.queue);
+
+	if (p)
+		cfs_runqueue.total_weight -= fair_weight(p);
+	return p;
+}
+
+static void cfs_absorb(void)
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, &readyqueue, list) {
+		list_del_init(&p->list);
+		cfs_enqueue(p);
+	}
+}
+
+static void cfs_checkpoint(struct checkpoint *c)
+{
+	fairq_checkpoint(&cfs_runqueue.queue, c);
+	checkpoint_write_u32(c, cfs_runqueue.slice);
+}
+
+static int cfs_restore(struct checkpoint *c)
+{
+	if (!fairq_restore(&cfs_runqueue.queue, c))
+		return -1;
+
+	cfs_runqueue.total_weight = 0;
+	for (unsigned int i = 0; i < cfs_runqueue.queue.heap.nr_queued; i++) {
+		cfs_runqueue.total_weight += fair_weight(cfs_runqueue.queue.heap.procs[i]);
+	}
+	cfs_runqueue.slice = checkpoint_read_u32(c);
+	return c->failed ? -1 : 0;
+}
+
+static struct process *cfs_steal(void)
+{
+	cfs_absorb();
+	return cfs_dequeue();
+}
+
+static struct process *cfs_schedule(void)
+{
+	struct process *next;
+
+	cfs_absorb();
+
+	if (fair_current_runnable()) {
+		fair_charge(current);
+		if (--cfs_runqueue.slice > 0)
+			return current;
+		cfs_enqueue(current);
+	}
+
+	next = cfs_dequeue();
+	if (next) {
+		unsigned int weight = fair_weight(next);
+
+		cfs_runqueue.slice = CFS_LATENCY * weight / (weight + cfs_runqueue.total_weight);
+		if (cfs_runqueue.slice < CFS_MIN_SLICE)
+			cfs_runqueue.slice = CFS_MIN_SLICE;
+	}
+	return next;
+}
+
+const struct scheduler cfs_scheduler = {
+	.name = "CFS",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.initialize = cfs_initialize,
+	.finalize = cfs_finalize,
+	.steal = cfs_steal,
+	.checkpoint = cfs_checkpoint,
+	.restore = cfs_restore,
+	.schedule = cfs_schedule,
+};
+
+/***********************************************************************
+ * Multi-level feedback queue scheduler
+ *
+ * DESCRIPTION
+ *   Run the first process on the highest occupied level until it uses up
+ *   the quantum of the level or a process shows up on a higher level. A
+ *   process that uses up its quantum moves one level down, and one that
+ *   blocks keeps the level and what is left of its quantum. At every
+ *   multiple of @boost_period ticks, all the processes go back to level 0 so
+ *   that the long-running ones are not starved. A boost splices the levels
+ *   together in O(levels), and each process remembers the boost period its
+ *   level is for, so that it gets its level and quantum reset when it gets
+ *   out of or back into the queue. See struct mlfq_params in sched.h.
+ ***********************************************************************/
+struct mlfq_params mlfq_params = {
+	.nr_levels = 4,
+	.quanta = { 2, 4, 8, 16 },
+	.boost_period = 128,
+};
+
+struct mlfq {
+	unsigned long long bitmap;		/* Bit n is set if levels[n] is not empty */
+	struct list_head levels[MLFQ_MAX_LEVELS];
+	unsigned int epoch;				/* The boost period the levels are for */
+};
+
+#define mlfq_readyqueue (*(struct mlfq *)sched_data)
+
+static inline unsigned int mlfq_epoch(void)
+{
+	return mlfq_params.boost_period ? ticks / mlfq_params.boost_period : 0;
+}
+
+static inline void mlfq_reset(struct process *p)
+{
+	p->__mlfq_level = p->__mlfq_used = 0;
+	p->__mlfq_epoch = mlfq_readyqueue.epoch;
+}
+
+static void mlfq_enqueue(struct process *p, bool head)
+{
+	struct list_head *level = mlfq_readyqueue.levels + p->__mlfq_level;
+
+	if (head)
+		list_add(&p->list, level);
+	else
+		list_add_tail(&p->list, level);
+	mlfq_readyqueue.bitmap |= 1ULL << p->__mlfq_level;
+}
+
+static struct process *mlfq_dequeue(void)
+{
+	unsigned int level;
+	struct process *p;
+
+	if (!mlfq_readyqueue.bitmap)
+		return NULL;
+
+	level = __builtin_ctzll(mlfq_readyqueue.bitmap);
+	p = list_first_entry(mlfq_readyqueue.levels + level, struct process, list);
+	list_del_init(&p->list);
+	if (list_empty(mlfq_readyqueue.levels + level))
+		mlfq_readyqueue.bitmap &= ~(1ULL << level);
+	if (p->__mlfq_epoch != mlfq_readyqueue.epoch)
+		mlfq_reset(p);
+	return p;
+}
+
+/**
+ * Move the processes the framework has put into @readyqueue to their levels
+ */
+static void mlfq_absorb(void)
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, &readyqueue, list) {
+		list_del_init(&p->list);
+		if (p->__mlfq_epoch != mlfq_readyqueue.epoch)
+			mlfq_reset(p);
+		mlfq_enqueue(p, false);
+	}
+}
+
+/**
+ * Bring everyone back to level 0, keeping the order of the levels and that
+ * within each level. The queued processes get their quanta reset as they are
+ * dequeued
+ */
+static void mlfq_boost(void)
+{
+	struct list_head *top = mlfq_readyqueue.levels;
+
+	for (unsigned int level = 1; level < mlfq_params.nr_levels; level++) {
+		list_splice_tail_init(mlfq_readyqueue.levels + level, top);
+	}
+	mlfq_readyqueue.epoch = mlfq_epoch();
+	if (current)
+		mlfq_reset(current);
+
+	mlfq_readyqueue.bitmap = list_empty(top) ? 0 : 1;
+}
+
+static int mlfq_initialize(void)
+{
+	sched_data = malloc(sizeof(struct mlfq));
+	if (!sched_data)
+		return -1;
+
+	mlfq_readyqueue.bitmap = 0;
+	for (unsigned int level = 0; level < MLFQ_MAX_LEVELS; level++) {
+		INIT_LIST_HEAD(mlfq_readyqueue.levels + level);
+	}
+	mlfq_readyqueue.epoch = 0;
+	return 0;
+}
+
+static void mlfq_finalize(void)
+{
+	free(sched_data);
+	sched_data = NULL;
+}
+
+/**
+ * The levels and the quanta of the processes are saved along with the
+ * processes themselves, so the queue is saved level by level. The parameters
+ * are saved as well so that the simulation is not resumed with others.
+ */
+static void mlfq_checkpoint(struct checkpoint *c)
+{
+	struct process *p;
+
+	checkpoint_write_u32(c, mlfq_params.nr_levels);
+	for (unsigned int level = 0; level < mlfq_params.nr_levels; level++) {
+		checkpoint_write_u32(c, mlfq_params.quanta[level]);
+	}
+	checkpoint_write_u32(c, mlfq_params.boost_period);
+	checkpoint_write_u32(c, mlfq_readyqueue.epoch);
+
+	for (unsigned int level = 0; level < mlfq_params.nr_levels; level++) {
+		unsigned int nr = 0;
+
+		list_for_each_entry(p, mlfq_readyqueue.levels + level, list) {
+			nr++;
+		}
+		checkpoint_write_u32(c, nr);
+		list_for_each_entry(p, mlfq_readyqueue.levels + level, list) {
+			checkpoint_write_process(c, p);
+		}
+	}
+}
+
+static int mlfq_restore(struct checkpoint *c)
+{
+	bool matches = checkpoint_read_u32(c) == mlfq_params.nr_levels;
+
+	for (unsigned int level = 0; matches && level < mlfq_params.nr_levels; level++) {
+		matches = checkpoint_read_u32(c) == mlfq_params.quanta[level];
+	}
+	if (!matches || checkpoint_read_u32(c) != mlfq_params.boost_period) {
+		fprintf(stderr, "The checkpoint was taken with different MLFQ parameters\n");
+		return -1;
+	}
+	mlfq_readyqueue.epoch = checkpoint_read_u32(c);
+
+	for (unsigned int level = 0; level < mlfq_params.nr_levels; level++) {
+		unsigned int nr = checkpoint_read_u32(c);
+
+		for (unsigned int i = 0; i < nr && !c->failed; i++) {
+			struct process *p = checkpoint_read_process(c);
+
+			if (!p)
+				return -1;
+			if (p->__mlfq_epoch != mlfq_readyqueue.epoch)
+				mlfq_reset(p);
+			if (p->__mlfq_level != level)
+				return -1;
+			mlfq_enqueue(p, false);
+		}
+	}
+	return c->failed ? -1 : 0;
+}
+
+static struct process *mlfq_steal(void)
+{
+	if (mlfq_epoch() != mlfq_readyqueue.epoch)
+		mlfq_boost();
+	mlfq_absorb();
+	return mlfq_dequeue();
+}
+
+static struct process *mlfq_schedule(void)
+{
+	if (mlfq_epoch() != mlfq_readyqueue.epoch)
+		mlfq_boost();
+	mlfq_absorb();
+
+	if (current && current->status != PROCESS_BLOCKED && current->age < current->lifespan) {
+		unsigned int level = current->__mlfq_level;
+
+		if (++current->__mlfq_used >= mlfq_params.quanta[level]) {
+			/* Used up the quantum. Go down a level if there is one */
+			if (level + 1 < mlfq_params.nr_levels)
+				current->__mlfq_level++;
+			current->__mlfq_used = 0;
+			mlfq_enqueue(current, false);
+		} else if (mlfq_readyqueue.bitmap & ((1ULL << level) - 1)) {
+			/* Preempted by a higher level. Resume the quantum after them */
+			mlfq_enqueue(current, true);
+		} else {
+			return current;
+		}
+	}
+
+	return mlfq_dequeue();
+}
+
+const struct scheduler mlfq_scheduler = {
+	.name = "Multi-level feedback queue",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.initialize = mlfq_initialize,
+	.finalize = mlfq_finalize,
+	.steal = mlfq_steal,
+	.checkpoint = mlfq_checkpoint,
+	.restore = mlfq_restore,
+	.schedule = mlfq_schedule,
+};
@@ -51,3 +51,67 @@ int parse_command(char *command, char *tokens[])
 
 	return nr_tokens;
 }
+
+static inline bool __is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+int parse_line(const char **pos, const char *end, struct token tokens[])
+{
+	const char *curr = *pos;
+	int nr_tokens = 0;
+
+	while (curr < end && *curr != '\n') {
+		const char *start;
+
+		if (__is_space(*curr)) {
+			curr++;
+			continue;
+		}
+
+		/* Remove comments */
+		if (*curr == '#') {
+			while (curr < end && *curr != '\n')
+				curr++;
+			break;
+		}
+
+		start = curr;
+		while (curr < end && !__is_space(*curr))
+			curr++;
+
+		if (nr_tokens < MAX_NR_TOKENS) {
+			tokens[nr_tokens] = (struct token) {
+				.str = start,
+				.len = curr - start,
+			};
+		}
+		nr_tokens++;
+	}
+
+	/* Step over the newline */
+	*pos = curr < end ? curr + 1 : end;
+
+	return nr_tokens;
+}
+
+int parse_int(const struct token *token)
+{
+	const char *curr = token->str;
+	const char *end = token->str + token->len;
+	bool negative = false;
+	unsigned int value = 0;
+
+	if (curr < end && (*curr == '-' || *curr == '+')) {
+		negative = *curr == '-';
+		curr++;
+	}
+
+	while (curr < end && *curr >= '0' && *curr <= '9') {
+		value = value * 10 + (*curr - '0');
+		curr++;
+	}
+
+	return negative ? -value : value;
+}
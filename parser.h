@@ -22,4 +22,25 @@
 
 int parse_command(char *command, char *tokens[]);
 
+/**
+ * A token pointing into the script buffer. It is not NUL-terminated
+ */
+struct token {
+	const char *str;
+	unsigned int len;
+};
+
+/**
+ * Zero-copy counterpart of parse_command(). Split the line at *@pos into
+ * @tokens in place, skipping the comment, and advance *@pos to the next line.
+ * Return the number of tokens in the line.
+ */
+int parse_line(const char **pos, const char *end, struct token tokens[]);
+
+/**
+ * Convert @token to an integer the same way atoi() does, without needing the
+ * token to be NUL-terminated
+ */
+int parse_int(const struct token *token);
+
 #endif
@@ -0,0 +1,99 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "pool.h"
+
+/**
+ * The objects follow the header at its size rounded up to @align
+ */
+struct pool_slab {
+	struct pool_slab *next;
+};
+
+static inline size_t __align_up(size_t size, size_t align)
+{
+	return (size + align - 1) & ~(align - 1);
+}
+
+void pool_init(struct pool *pool, size_t object_size, size_t align, size_t nr_per_slab)
+{
+	assert(!(align & (align - 1)));
+
+	if (align < sizeof(long long))
+		align = sizeof(long long);
+	if (object_size < sizeof(void *))
+		object_size = sizeof(void *);
+
+	pool->object_size = __align_up(object_size, align);
+	pool->align = align;
+	pool->nr_per_slab = nr_per_slab;
+	pool->slabs = NULL;
+	pool->nr_used = nr_per_slab;
+	pool->free_list = NULL;
+}
+
+void *pool_alloc(struct pool *pool)
+{
+	void *object;
+
+	if (pool->free_list) {
+		object = pool->free_list;
+		pool->free_list = *(void **)object;
+		return object;
+	}
+
+	if (pool->nr_used == pool->nr_per_slab) {
+		struct pool_slab *slab;
+		void *memory;
+
+		if (posix_memalign(&memory, pool->align,
+				__align_up(sizeof(*slab), pool->align) +
+						pool->object_size * pool->nr_per_slab)) {
+			fprintf(stderr, "Out of memory\n");
+			abort();
+		}
+		slab = memory;
+		slab->next = pool->slabs;
+		pool->slabs = slab;
+		pool->nr_used = 0;
+	}
+
+	object = (char *)pool->slabs + __align_up(sizeof(*pool->slabs), pool->align) +
+			pool->object_size * pool->nr_used++;
+	return object;
+}
+
+void pool_free(struct pool *pool, void *object)
+{
+	assert(object);
+
+	*(void **)object = pool->free_list;
+	pool->free_list = object;
+}
+
+void pool_destroy(struct pool *pool)
+{
+	while (pool->slabs) {
+		struct pool_slab *slab = pool->slabs;
+		pool->slabs = slab->next;
+		free(slab);
+	}
+	pool->nr_used = pool->nr_per_slab;
+	pool->free_list = NULL;
+}
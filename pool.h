@@ -0,0 +1,51 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stddef.h>
+
+/***********************************************************************
+ * struct pool
+ *
+ * DESCRIPTION
+ *   Slab allocator for objects of the same size. Objects are carved out of
+ *   big slabs in the allocation order, so the objects allocated one after
+ *   another (e.g., the processes in a script) sit next to each other in
+ *   memory. Freed objects are recycled through @free_list, and all objects
+ *   are torn down at once by pool_destroy().
+ *
+ *   Objects are aligned to @align, which is a power of two or 0 for that of
+ *   long long. Pass the cache line size to keep each object from straddling
+ *   more lines than it is in size.
+ */
+struct pool {
+	size_t object_size;			/* Size of each object, rounded up for alignment */
+	size_t align;				/* Alignment of the objects */
+	size_t nr_per_slab;			/* # of objects in a slab */
+
+	struct pool_slab *slabs;	/* Slabs allocated so far, newest first */
+	size_t nr_used;				/* # of objects carved out of @slabs */
+
+	void *free_list;			/* Freed objects to recycle */
+};
+
+void pool_init(struct pool *pool, size_t object_size, size_t align, size_t nr_per_slab);
+void *pool_alloc(struct pool *pool);
+void pool_free(struct pool *pool, void *object);
+void pool_destroy(struct pool *pool);
+
+#endif
@@ -0,0 +1,212 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "list_head.h"
+#include "process.h"
+
+#include "prioq.h"
+#include "checkpoint.h"
+
+#if MAX_PRIO > 64
+#error "struct prioq can track up to 64 priority levels in its bitmap"
+#endif
+
+static inline unsigned int __level_of(unsigned int prio)
+{
+	return prio < MAX_PRIO ? prio : MAX_PRIO;
+}
+
+void prioq_init(struct prioq *q)
+{
+	q->bitmap = 0;
+	for (int i = 0; i <= MAX_PRIO; i++) {
+		INIT_LIST_HEAD(q->levels + i);
+	}
+	q->nr_top = q->nr_above = q->nr_queued = 0;
+	q->head_seq = 0;
+	q->tail_seq = 1;
+}
+
+/**
+ * Link @p into the level for its priority, keeping the level sorted on the
+ * sequence numbers. Fresh sequences always go to either end of a level, so
+ * the walk only happens when prioq_update() reinserts an old one.
+ */
+static void __prioq_link(struct prioq *q, struct process *p)
+{
+	unsigned int level = __level_of(p->prio);
+	struct list_head *head = q->levels + level;
+	struct list_head *pos = head;
+
+	if (!list_empty(head) &&
+			list_first_entry(head, struct process, list)->__prioq_seq < p->__prioq_seq) {
+		list_for_each_prev(pos, head) {
+			if (list_entry(pos, struct process, list)->__prioq_seq < p->__prioq_seq)
+				break;
+		}
+	}
+	__list_add(&p->list, pos, pos->next);
+
+	p->__prioq = q;
+	p->__prioq_prio = p->prio;
+	if (level < MAX_PRIO) {
+		q->bitmap |= 1ULL << level;
+	} else {
+		q->nr_top++;
+		if (p->prio > MAX_PRIO)
+			q->nr_above++;
+	}
+	q->nr_queued++;
+}
+
+static void __prioq_unlink(struct prioq *q, struct process *p)
+{
+	unsigned int level = __level_of(p->__prioq_prio);
+
+	list_del_init(&p->list);
+	p->__prioq = NULL;
+
+	if (level < MAX_PRIO) {
+		if (list_empty(q->levels + level))
+			q->bitmap &= ~(1ULL << level);
+	} else {
+		q->nr_top--;
+		if (p->__prioq_prio > MAX_PRIO)
+			q->nr_above--;
+	}
+	q->nr_queued--;
+}
+
+void prioq_add_tail(struct prioq *q, struct process *p)
+{
+	assert(list_empty(&p->list));
+
+	p->__prioq_seq = q->tail_seq++;
+	__prioq_link(q, p);
+}
+
+void prioq_add(struct prioq *q, struct process *p)
+{
+	assert(list_empty(&p->list));
+
+	p->__prioq_seq = q->head_seq--;
+	__prioq_link(q, p);
+}
+
+void prioq_splice_tail_init(struct prioq *q, struct list_head *list)
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, list, list) {
+		list_del_init(&p->list);
+		prioq_add_tail(q, p);
+	}
+}
+
+void prioq_update(struct prioq *q, struct process *p)
+{
+	if (p->prio == p->__prioq_prio)
+		return;
+
+	__prioq_unlink(q, p);
+	__prioq_link(q, p);
+}
+
+struct process *prioq_peek(struct prioq *q)
+{
+	struct list_head *head;
+	struct process *next;
+
+	if (q->nr_top) {
+		head = q->levels + MAX_PRIO;
+		next = list_first_entry(head, struct process, list);
+
+		/* Entries above MAX_PRIO are not sorted on prio. Find the first max */
+		if (q->nr_above) {
+			struct process *p;
+			list_for_each_entry(p, head, list) {
+				if (p->__prioq_prio > next->__prioq_prio)
+					next = p;
+			}
+		}
+	} else if (q->bitmap) {
+		head = q->levels + (63 - __builtin_clzll(q->bitmap));
+		next = list_first_entry(head, struct process, list);
+	} else {
+		return NULL;
+	}
+
+	return next;
+}
+
+struct process *prioq_pop(struct prioq *q)
+{
+	struct process *next = prioq_peek(q);
+
+	if (next)
+		__prioq_unlink(q, next);
+	return next;
+}
+
+void prioq_checkpoint(struct prioq *q, struct checkpoint *c)
+{
+	struct process *p;
+	int level;
+
+	checkpoint_write_s64(c, q->head_seq);
+	checkpoint_write_s64(c, q->tail_seq);
+	checkpoint_write_u32(c, q->nr_queued);
+
+	prioq_for_each_entry(p, q, level) {
+		checkpoint_write_process(c, p);
+		checkpoint_write_u32(c, p->__prioq_prio);
+		checkpoint_write_s64(c, p->__prioq_seq);
+	}
+}
+
+bool prioq_restore(struct prioq *q, struct checkpoint *c)
+{
+	unsigned int nr_queued;
+
+	q->head_seq = checkpoint_read_s64(c);
+	q->tail_seq = checkpoint_read_s64(c);
+	nr_queued = checkpoint_read_u32(c);
+
+	/* The processes come in the level order, and in the queueing order in each */
+	for (unsigned int i = 0; i < nr_queued && !c->failed; i++) {
+		struct process *p = checkpoint_read_process(c);
+		unsigned int prio = checkpoint_read_u32(c);
+		long long seq = checkpoint_read_s64(c);
+		unsigned int effective;
+
+		if (!p || !list_empty(&p->list)) {
+			c->failed = true;
+			break;
+		}
+
+		/* Queue @p with the priority it was queued with, which @prio may not be any longer */
+		effective = p->prio;
+		p->prio = prio;
+		p->__prioq_seq = seq;
+		__prioq_link(q, p);
+		p->prio = effective;
+	}
+	return !c->failed;
+}
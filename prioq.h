@@ -0,0 +1,118 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __PRIOQ_H__
+#define __PRIOQ_H__
+
+#include <stdbool.h>
+
+#include "list_head.h"
+#include "process.h"
+
+struct checkpoint;
+
+/***********************************************************************
+ * struct prioq
+ *
+ * DESCRIPTION
+ *   Multi-level ready queue for the priority-based schedulers. Each priority
+ *   level has its own list, and @bitmap tells which of the levels below
+ *   MAX_PRIO are occupied so that the highest one is found with a single
+ *   find-last-set. Processes at MAX_PRIO or above (PCP boost, aging and PIP
+ *   can push @prio that far) share the top level, which is looked at first.
+ *
+ *   Every process is stamped with a sequence number when it gets enqueued,
+ *   and each level is kept sorted on that number. This makes the queue behave
+ *   exactly like scanning a single FIFO list for the first process with the
+ *   highest priority, including when a queued process changes its priority.
+ *
+ *   A process is linked through its @list field, so it can be in the prioq or
+ *   in some other list, but not in both at the same time.
+ */
+struct prioq {
+	unsigned long long bitmap;		/* Bit n is set if levels[n] is not empty */
+	struct list_head levels[MAX_PRIO + 1];
+									/* levels[MAX_PRIO] holds prio >= MAX_PRIO */
+	unsigned int nr_top;			/* # of processes in levels[MAX_PRIO] */
+	unsigned int nr_above;			/* # of them with prio > MAX_PRIO */
+	unsigned int nr_queued;			/* # of processes in the queue */
+
+	long long head_seq;				/* Sequence for the next prioq_add() */
+	long long tail_seq;				/* Sequence for the next prioq_add_tail() */
+};
+
+void prioq_init(struct prioq *q);
+
+/**
+ * Enqueue @p according to its current @prio. prioq_add_tail() puts @p behind
+ * the processes with the same priority whereas prioq_add() puts @p in front
+ * of them, like list_add_tail() and list_add() do.
+ */
+void prioq_add_tail(struct prioq *q, struct process *p);
+void prioq_add(struct prioq *q, struct process *p);
+
+/**
+ * Move all the processes in @list into @q in the list order, leaving @list
+ * empty. Used to absorb the processes the framework has put into @readyqueue.
+ */
+void prioq_splice_tail_init(struct prioq *q, struct list_head *list);
+
+/**
+ * Reposition @p after its @prio has been changed while being in @q. @p keeps
+ * its place among the processes that end up with the same priority.
+ */
+void prioq_update(struct prioq *q, struct process *p);
+
+/**
+ * Iterate over the processes in @q from the highest level to the lowest, in
+ * the queueing order within each level
+ */
+#define prioq_for_each_entry(pos, q, level) \
+	for (level = MAX_PRIO; level >= 0; level--) \
+		list_for_each_entry(pos, (q)->levels + level, list)
+
+/**
+ * Return the first process with the highest priority without detaching it.
+ * Return NULL if @q is empty.
+ */
+struct process *prioq_peek(struct prioq *q);
+
+/**
+ * Detach and return the first process with the highest priority.
+ * Return NULL if @q is empty.
+ */
+struct process *prioq_pop(struct prioq *q);
+
+/**
+ * Save the processes in @q along with their places into the checkpoint @c,
+ * and put them back into the empty @q. See checkpoint.h
+ */
+void prioq_checkpoint(struct prioq *q, struct checkpoint *c);
+bool prioq_restore(struct prioq *q, struct checkpoint *c);
+
+/**
+ * The prioq @p is queued in, or NULL if @p is not in any
+ */
+static inline struct prioq *prioq_of(struct process *p)
+{
+	return p->__prioq;
+}
+
+static inline bool prioq_empty(struct prioq *q)
+{
+	return q->nr_queued == 0;
+}
+
+#endif
@@ -17,6 +17,8 @@
 #define __PROCESS_H__
 
 struct list_head;
+struct prioq;
+struct resource;
 
 enum process_status {
 	PROCESS_READY,		/* Process is ready to run */
@@ -25,7 +27,44 @@ enum process_status {
 	PROCESS_EXIT,		/* The process is exited */
 };
 
+#define CACHELINE_SIZE	64
+
+/**
+ * The fields of a process that are looked at only when it forks, exits, or
+ * acquires and releases resources, and when the simulation is checkpointed.
+ * They are kept away from struct process so that walking through the ready
+ * queues does not drag them into the cache. DO NOT ACCESS THEM either.
+ */
+struct process_cold {
+	unsigned int __starts_at;	/* When to fork the process */
+
+	struct list_head __resources_to_acquire;
+								/* Schedule to acquire resources */
+
+	struct list_head __resources_holding;
+								/* Resources that the process is currently holding */
+
+	unsigned int __first_run_at;	/* Metrics. See struct metrics_record */
+	unsigned int __blocked_at;	/* When the process got blocked. UINT_MAX if not */
+	unsigned int __blocked_ticks;
+	unsigned int __nr_preemptions;
+
+	unsigned int __waiting_for;	/* The resource the last acquisition was blocked on.
+								   UINT_MAX if it went through */
+
+	unsigned int __checkpoint_id;	/* Index in the checkpoint being written plus one */
+};
+
+/**
+ * The first cache line holds what the schedulers and the queues look at for
+ * every process in a queue; the list head, the status, the age, the lifespan,
+ * and the priority along with the prioq linkage. The rest fits in the second
+ * line, and the cold part lives in a separate pool. The simulator allocates
+ * processes at CACHELINE_SIZE boundaries for the lines to stay as such.
+ */
 struct process {
+	struct list_head list;	/* list head for listing processes */
+
 	unsigned int pid;		/* Process ID */
 
 	enum process_status status;
@@ -39,21 +78,44 @@ struct process {
 							   0 by default, and the larger, the more important
 							   process it is */
 
-	struct list_head list;	/* list head for listing processes */
+	/** DO NOT ACCESS FOLLOWING VARIABLES. THESE ARE USED FOR SIMULATOR IMPLEMENTATION **/
+	unsigned int __cpu;			/* The CPU the process is homed on */
+
+	struct prioq *__prioq;		/* The prioq the process is in. NULL if not in any */
+	unsigned int __prioq_prio;	/* Priority the process is queued with in prioq */
+	long long __prioq_seq;		/* Order of the process in its prioq level */
+
+	/* Only one kind of these ready queues is in use at a time */
+	union {
+		struct {
+			long long __agingq_key;	/* Priority minus the aging epoch when queued in agingq */
+			long long __agingq_seq;	/* Order of the process in agingq */
+		};
+		struct {
+			long long __fairq_key;	/* Virtual time of the process. See fairq.h */
+			long long __fairq_seq;	/* Order of the process in fairq */
+		};
+		struct {
+			unsigned int __mlfq_level;	/* Level of the process in MLFQ. 0 is the top */
+			unsigned int __mlfq_used;	/* Ticks run out of the quantum of the level */
+			unsigned int __mlfq_epoch;	/* Boost period @__mlfq_level is valid for */
+		};
+		long long __queue_state[2];	/* All of the above, for checkpoints */
+	};
+
+	struct process_cold *__cold;
+	/** END OF THE SIMULATOR VARIABLES **/
 
 	unsigned int prio_orig;	/* The original priority of the process. You might
 							   need it to implement dynamic priority features
 							   such as aging, PIP and PCP. */
 
-
-	/** DO NOT ACCESS FOLLOWING VARIABLES. THESE ARE USED FOR SIMULATOR IMPLEMENTATION **/
-	unsigned int __starts_at;	/* When to fork the process */
-
-	struct list_head __resources_to_acquire;
-								/* Schedule to acquire resources */
-
-	struct list_head __resources_holding;
-								/* Resources that the process is currently holding */
+	struct list_head holding;
+							/* Resources the process is holding, linked through
+							   their @held. Maintained by the PIP scheduler */
+	struct resource *blocked_on;
+							/* The resource the process is waiting for.
+							   Maintained by the PIP scheduler */
 };
 
 /**
@@ -0,0 +1,56 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "list_head.h"
+#include "process.h"
+
+#include "procheap.h"
+
+#define PROCHEAP_INITIAL_SLOTS	64
+
+void procheap_init(struct procheap *h)
+{
+	h->procs = NULL;
+	h->nr_queued = h->nr_slots = 0;
+}
+
+void procheap_destroy(struct procheap *h)
+{
+	free(h->procs);
+	procheap_init(h);
+}
+
+void procheap_reserve(struct procheap *h, unsigned int nr_queued)
+{
+	unsigned int nr_slots = h->nr_slots ? h->nr_slots : PROCHEAP_INITIAL_SLOTS;
+	struct process **procs;
+
+	if (nr_queued <= h->nr_slots)
+		return;
+
+	while (nr_slots < nr_queued) {
+		nr_slots *= 2;
+	}
+	procs = realloc(h->procs, sizeof(*procs) * nr_slots);
+	if (!procs) {
+		fprintf(stderr, "Out of memory\n");
+		abort();
+	}
+	h->procs = procs;
+	h->nr_slots = nr_slots;
+}
@@ -0,0 +1,99 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __PROCHEAP_H__
+#define __PROCHEAP_H__
+
+#include <stdbool.h>
+
+#include "list_head.h"
+#include "process.h"
+
+/***********************************************************************
+ * struct procheap
+ *
+ * DESCRIPTION
+ *   Binary heap of processes underlying agingq and fairq. The order comes
+ *   from the before() function the queue passes in, which tells whether @a
+ *   should be popped before @b. The operations are inlined into each queue so
+ *   that before() is called directly rather than through the pointer.
+ *
+ *   @procs is laid out as an implicit binary tree, so saving it in this order
+ *   and putting the processes back in the same order restores the heap as is.
+ */
+struct procheap {
+	struct process **procs;			/* The queued processes, in the heap order */
+	unsigned int nr_queued;			/* # of processes in @procs */
+	unsigned int nr_slots;			/* # of processes @procs can hold */
+};
+
+typedef bool (*procheap_before_fn)(struct process *a, struct process *b);
+
+void procheap_init(struct procheap *h);
+void procheap_destroy(struct procheap *h);
+
+/**
+ * Make room for @nr_queued processes in @h
+ */
+void procheap_reserve(struct procheap *h, unsigned int nr_queued);
+
+static inline void procheap_push(struct procheap *h, struct process *p,
+		procheap_before_fn before)
+{
+	unsigned int i;
+
+	if (h->nr_queued == h->nr_slots)
+		procheap_reserve(h, h->nr_queued + 1);
+
+	for (i = h->nr_queued++; i > 0; i = (i - 1) / 2) {
+		struct process *parent = h->procs[(i - 1) / 2];
+
+		if (!before(p, parent))
+			break;
+		h->procs[i] = parent;
+	}
+	h->procs[i] = p;
+}
+
+/**
+ * Detach and return the first process in @h. Return NULL if @h is empty.
+ */
+static inline struct process *procheap_pop(struct procheap *h, procheap_before_fn before)
+{
+	struct process *next, *last;
+	unsigned int i = 0;
+
+	if (h->nr_queued == 0)
+		return NULL;
+
+	next = h->procs[0];
+	last = h->procs[--h->nr_queued];
+
+	while (2 * i + 1 < h->nr_queued) {
+		unsigned int child = 2 * i + 1;
+
+		if (child + 1 < h->nr_queued && before(h->procs[child + 1], h->procs[child]))
+			child++;
+		if (!before(h->procs[child], last))
+			break;
+		h->procs[i] = h->procs[child];
+		i = child;
+	}
+	h->procs[i] = last;
+
+	return next;
+}
+
+#endif
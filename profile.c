@@ -0,0 +1,77 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include "profile.h"
+
+#ifdef CONFIG_PROFILE
+
+#include <stdio.h>
+#include <string.h>
+
+static const char *__callback_names[NR_PROFILE_CALLBACKS] = {
+	[PROFILE_SCHEDULE] = "schedule",
+	[PROFILE_ACQUIRE] = "acquire",
+	[PROFILE_RELEASE] = "release",
+	[PROFILE_FORKED] = "forked",
+	[PROFILE_EXITING] = "exiting",
+	[PROFILE_STEAL] = "steal",
+};
+
+static const char *__sample_names[NR_PROFILE_SAMPLES] = {
+	[PROFILE_NR_PROCESSES] = "processes on the CPU at schedule()",
+	[PROFILE_NR_WAITERS] = "waiters at acquire() and release()",
+};
+
+void profile_init(struct profile *profile)
+{
+	memset(profile, 0x00, sizeof(*profile));
+}
+
+/**
+ * Print the non-empty buckets of @h as [from, to): count
+ */
+static void __print_histogram(FILE *file, const char *name, const char *unit,
+		const struct profile_histogram *h)
+{
+	if (!h->nr_samples)
+		return;
+
+	fprintf(file, "%s: %llu samples, avg %.1f, max %llu%s\n", name, h->nr_samples,
+			(double)h->sum / h->nr_samples, h->max, unit);
+
+	for (unsigned int i = 0; i < PROFILE_NR_BUCKETS; i++) {
+		unsigned long long from = i ? 1ULL << (i - 1) : 0;
+		unsigned long long to = 1ULL << i;
+
+		if (!h->buckets[i])
+			continue;
+		fprintf(file, "  [%llu, %llu): %llu\n", from, to, h->buckets[i]);
+	}
+}
+
+void profile_print(FILE *file, const char *name, const struct profile *profile)
+{
+	fprintf(file, "***** PROFILE: %s *****\n", name);
+
+	for (unsigned int i = 0; i < NR_PROFILE_CALLBACKS; i++) {
+		__print_histogram(file, __callback_names[i], " " PROFILE_UNIT, profile->callbacks + i);
+	}
+	for (unsigned int i = 0; i < NR_PROFILE_SAMPLES; i++) {
+		__print_histogram(file, __sample_names[i], "", profile->samples + i);
+	}
+	fprintf(file, "\n");
+}
+
+#endif
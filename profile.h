@@ -0,0 +1,121 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+/***********************************************************************
+ * Scheduler callback profiling
+ *
+ * DESCRIPTION
+ *   Built with `make PROFILE=1`, the simulator times every call into
+ *   struct scheduler and samples the queue lengths the callbacks decide on,
+ *   into histograms with power-of-two buckets. The report is printed when
+ *   the simulation is over. Otherwise PROFILED() is just the call and
+ *   profile_sample() is nothing, so there is no overhead at all.
+ */
+enum profile_callback {
+	PROFILE_SCHEDULE,
+	PROFILE_ACQUIRE,
+	PROFILE_RELEASE,
+	PROFILE_FORKED,
+	PROFILE_EXITING,
+	PROFILE_STEAL,
+	NR_PROFILE_CALLBACKS,
+};
+
+enum profile_sample {
+	PROFILE_NR_PROCESSES,		/* # of processes on the CPU at schedule() */
+	PROFILE_NR_WAITERS,			/* # of waiters of the resource at acquire() and release() */
+	NR_PROFILE_SAMPLES,
+};
+
+#ifdef CONFIG_PROFILE
+
+#include <stdio.h>
+#include <time.h>
+
+#define PROFILE_NR_BUCKETS	48
+
+struct profile_histogram {
+	unsigned long long nr_samples;
+	unsigned long long sum;
+	unsigned long long max;
+	unsigned long long buckets[PROFILE_NR_BUCKETS];
+								/* Bucket n counts the values in [2^(n-1), 2^n) */
+};
+
+struct profile {
+	struct profile_histogram callbacks[NR_PROFILE_CALLBACKS];
+	struct profile_histogram samples[NR_PROFILE_SAMPLES];
+};
+
+/**
+ * Timestamps are in TSC cycles on x86, and in nanoseconds elsewhere
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define PROFILE_UNIT	"cycles"
+
+static inline unsigned long long profile_stamp(void)
+{
+	return __builtin_ia32_rdtsc();
+}
+#else
+#define PROFILE_UNIT	"ns"
+
+static inline unsigned long long profile_stamp(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+static inline void profile_account(struct profile_histogram *h, unsigned long long value)
+{
+	unsigned int bucket = value ? 64 - __builtin_clzll(value) : 0;
+
+	if (bucket >= PROFILE_NR_BUCKETS)
+		bucket = PROFILE_NR_BUCKETS - 1;
+
+	h->nr_samples++;
+	h->sum += value;
+	if (value > h->max)
+		h->max = value;
+	h->buckets[bucket]++;
+}
+
+void profile_init(struct profile *profile);
+void profile_print(FILE *file, const char *name, const struct profile *profile);
+
+#define PROFILED(profile, callback, call) do {                                \
+		unsigned long long __profile_begin = profile_stamp();                 \
+		call;                                                                 \
+		profile_account((profile)->callbacks + (callback),                    \
+				profile_stamp() - __profile_begin);                           \
+	} while (0)
+
+#define profile_sample(profile, sample, value)                                \
+	profile_account((profile)->samples + (sample), (value))
+
+#else
+
+#define PROFILED(profile, callback, call) do { call; } while (0)
+#define profile_sample(profile, sample, value) do { } while (0)
+
+#endif
+
+#endif
@@ -17,11 +17,23 @@
 #define __RESOURCE_H__
 
 #include "list_head.h"
+#include "prioq.h"
 
 struct process;
 
 /**
- * Resources in the system.
+ * # of the processes waiting for a resource at each original priority; those
+ * above MAX_PRIO count as MAX_PRIO. Allocated once the resource is waited for
+ */
+struct resource_waiters {
+	unsigned int nr;
+	unsigned int nr_at[MAX_PRIO + 1];
+};
+
+/**
+ * Resources in the system. The table has thousands of them in some models,
+ * so keep this to a cache line; whatever is big or only needed once the
+ * resource is waited for goes behind a pointer.
  */
 struct resource {
 	/**
@@ -34,12 +46,45 @@ struct resource {
 	 * list head to list processes that are wanting for the resource
 	 */
 	struct list_head waitqueue;
+
+	/**
+	 * Processes that are wanting for the resource, ordered on their priority.
+	 * prioq_pop() hands out the first waiter with the highest priority as
+	 * scanning @waitqueue would do, but without the scan. A process can wait
+	 * either in @waitqueue or in @prio_waitqueue.
+	 *
+	 * NULL until the resource gets a waiter. Get it with
+	 * resource_prio_waitqueue() to queue a waiter. The simulator takes it
+	 * back once it turns empty after a release
+	 */
+	struct prioq *prio_waitqueue;
+
+	/**
+	 * list head to list the resources that @owner is holding.
+	 * Maintained by the PIP scheduler
+	 */
+	struct list_head held;
+
+	/**
+	 * DO NOT ACCESS. The waiters by their original priority, and how many of
+	 * them are above @owner. Maintained by the simulator to account the
+	 * inversion time
+	 */
+	struct resource_waiters *__waiters;
+	unsigned int __nr_inverted;
 };
 
 /**
- * This system has 16 different resources. It is defined in sched.c as an array of
- * struct resource (i.e., struct resource resources[NR_RESOURCES];)
+ * The priority-ordered waitqueue of @r, which is set up on the first call
+ */
+struct prioq *resource_prio_waitqueue(struct resource *r);
+
+/**
+ * The resource table is sized when the script is loaded, to the highest
+ * resource id in the script plus one or to the limit given with -R, and is
+ * reached through @resources and NR_RESOURCES in sim.h. Resource ids are
+ * 16-bit wide in the binary trace, hence the upper bound.
  */
-#define NR_RESOURCES 16
+#define MAX_RESOURCES	65536
 
 #endif
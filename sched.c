@@ -17,9 +17,18 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdarg.h>
+#include <limits.h>
 #include <assert.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <dirent.h>
 
 #include "list_head.h"
 
@@ -28,40 +37,63 @@
 #include "resource.h"
 
 #include "sched.h"
+#include "trace.h"
+#include "pool.h"
+#include "workload.h"
+#include "sim.h"
+#include "checkpoint.h"
 
 /**
- * List head to hold the processes ready to run
+ * The simulation the calling thread is working on. See sim.h
  */
-LIST_HEAD(readyqueue);
+__thread struct sim_context *sim = NULL;
 
 /**
- * The process that is currently running
+ * Following code is to maintain the simulator itself.
  */
-struct process *current = NULL;
+struct resource_schedule {
+	unsigned int resource_id;
+	unsigned int at;			/* The age to acquire the resource at */
+	unsigned int duration;		/* # of ticks to hold the resource for */
+	unsigned int release_at;	/* The age to release the resource at once acquired */
+	struct list_head list;
+};
 
 /**
- * Number of generated ticks since the simulator was started
+ * Processes and resource schedules are allocated from the slabs in the
+ * pools of each simulation, and are all released at once by sim_destroy().
  */
-unsigned int ticks = 0;
+#define POOL_NR_OBJECTS_PER_SLAB	4096
 
 /**
- * Resources in the system.
+ * Only the resources being waited for get their waiter counts and priority
+ * waitqueues, which are much fewer and bigger than the processes
  */
-struct resource resources[NR_RESOURCES];
+#define POOL_NR_WAITED_PER_SLAB		64
+
+bool quiet = false;
 
 /**
- * Following code is to maintain the simulator itself.
+ * Fast-forward over uneventful ticks. True if started with -F option
  */
-struct resource_schedule {
-	unsigned int resource_id;
-	unsigned int at;
-	unsigned int duration;
-	struct list_head list;
-};
+static bool fastforward = false;
 
-static LIST_HEAD(__forkqueue);
+/**
+ * Print the scheduling metrics when the simulation is over. True if started
+ * with -M option
+ */
+static bool print_metrics = false;
 
-bool quiet = false;
+/**
+ * Stop the simulation as soon as the processes deadlock on resources. True
+ * if started with --stop-on-deadlock option
+ */
+static bool stop_on_deadlock = false;
+
+/**
+ * Number of CPUs to simulate, given with -P option
+ */
+static unsigned int nr_cpus = 1;
 
 static const char *__process_status_sz[] = {
 	"RDY",
@@ -70,333 +102,3033 @@ static const char *__process_status_sz[] = {
 	"EXT",
 };
 
-/**
- * Assorted schedulers
- */
-extern struct scheduler fcfs_scheduler;
-extern struct scheduler sjf_scheduler;
-extern struct scheduler stcf_scheduler;
-extern struct scheduler rr_scheduler;
-extern struct scheduler prio_scheduler;
-extern struct scheduler pa_scheduler;
-extern struct scheduler pcp_scheduler;
-extern struct scheduler pip_scheduler;
+/**
+ * Assorted schedulers
+ */
+extern const struct scheduler fcfs_scheduler;
+extern const struct scheduler sjf_scheduler;
+extern const struct scheduler stcf_scheduler;
+extern const struct scheduler rr_scheduler;
+extern const struct scheduler prio_scheduler;
+extern const struct scheduler pa_scheduler;
+extern const struct scheduler pcp_scheduler;
+extern const struct scheduler pip_scheduler;
+extern const struct scheduler stride_scheduler;
+extern const struct scheduler cfs_scheduler;
+extern const struct scheduler mlfq_scheduler;
+
+#define NR_SCHEDULERS	11
+
+/**
+ * All the schedulers and their command-line options, in the same order
+ */
+static const struct scheduler *__schedulers[NR_SCHEDULERS] = {
+	&fcfs_scheduler, &sjf_scheduler, &stcf_scheduler, &rr_scheduler,
+	&prio_scheduler, &pa_scheduler, &pcp_scheduler, &pip_scheduler,
+	&stride_scheduler, &cfs_scheduler, &mlfq_scheduler,
+};
+static const char __scheduler_options[NR_SCHEDULERS + 1] = "fsSrpacidvL";
+
+static unsigned int __index_of(const struct scheduler *s)
+{
+	unsigned int i;
+
+	for (i = 0; __schedulers[i] != s; i++)
+		;
+	return i;
+}
+
+static char __option_of(const struct scheduler *s)
+{
+	return __scheduler_options[__index_of(s)];
+}
+
+/**
+ * The scheduler to simulate, selected in the command line
+ */
+static const struct scheduler *sched = &fcfs_scheduler;
+
+/**
+ * Schedulers selected in the command line, in the order given
+ */
+static const struct scheduler *__selected[NR_SCHEDULERS];
+static unsigned int __nr_selected = 0;
+
+/**
+ * Events are formatted into @sim->__events and written out to stderr in big chunks
+ * instead of issuing a few write()s for each event on the unbuffered stderr.
+ */
+#define EVENT_BUFFER_SIZE	(1 << 20)
+
+static void __flush_events(void)
+{
+	if (!sim->__nr_events_bytes)
+		return;
+
+	if (sim->__discard_events) {
+		sim->__nr_events_bytes = 0;
+		return;
+	}
+
+	fwrite(sim->__events, 1, sim->__nr_events_bytes,
+			sim->__events_stream ? sim->__events_stream : stderr);
+	sim->__nr_events_bytes = 0;
+}
+
+static void __emit_event(unsigned int pid, const char *fmt, ...)
+{
+	va_list args;
+	size_t indent = (size_t)pid * 4;
+	int len;
+
+	/* No point in formatting the events to throw away, with the long indents */
+	if (sim->__discard_events)
+		return;
+
+	if (sim->__nr_events_bytes + 32 > EVENT_BUFFER_SIZE)
+		__flush_events();
+	if (NR_CPUS > 1) {
+		sim->__nr_events_bytes += sprintf(sim->__events + sim->__nr_events_bytes,
+				"%3d/%d: ", ticks, this_cpu);
+	} else {
+		sim->__nr_events_bytes += sprintf(sim->__events + sim->__nr_events_bytes,
+				"%3d: ", ticks);
+	}
+
+	/* Indent 4 spaces per pid. It can be longer than the buffer for huge pids */
+	while (indent) {
+		size_t room = EVENT_BUFFER_SIZE - sim->__nr_events_bytes;
+
+		if (!room) {
+			__flush_events();
+			continue;
+		}
+		if (room > indent)
+			room = indent;
+		memset(sim->__events + sim->__nr_events_bytes, ' ', room);
+		sim->__nr_events_bytes += room;
+		indent -= room;
+	}
+
+	va_start(args, fmt);
+	len = vsnprintf(sim->__events + sim->__nr_events_bytes, EVENT_BUFFER_SIZE - sim->__nr_events_bytes,
+			fmt, args);
+	va_end(args);
+
+	if (sim->__nr_events_bytes + len >= EVENT_BUFFER_SIZE) {
+		/* Didn't fit. Flush out the prefix and format again */
+		__flush_events();
+		va_start(args, fmt);
+		len = vsnprintf(sim->__events, EVENT_BUFFER_SIZE, fmt, args);
+		va_end(args);
+	}
+	sim->__nr_events_bytes += len;
+}
+
+#define __print_event(pid, string, args...)   \
+	do {                                      \
+		__emit_event(pid, string "\n", ##args); \
+	} while (0);
+
+static int __open_trace(const char *filename)
+{
+	struct trace_header header = {
+		.version = TRACE_VERSION,
+		.record_size = sizeof(struct trace_record),
+		.nr_cpus = NR_CPUS,
+	};
+
+	sim->__trace = fopen(filename, "wb");
+	if (!sim->__trace) {
+		fprintf(stderr, "Cannot open trace file %s\n", filename);
+		return false;
+	}
+	setvbuf(sim->__trace, NULL, _IOFBF, EVENT_BUFFER_SIZE);
+
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	fwrite(&header, sizeof(header), 1, sim->__trace);
+	return true;
+}
+
+static void __close_trace(void)
+{
+	if (!sim->__trace)
+		return;
+
+	fclose(sim->__trace);
+	sim->__trace = NULL;
+}
+
+static inline void __trace_event(enum trace_event_type type, struct process *p,
+		unsigned int resource_id)
+{
+	struct trace_record r = {
+		.tick = ticks,
+		.pid = p ? p->pid : 0,
+		.prio = p ? p->prio : 0,
+		.resource_id = resource_id,
+		.type = type,
+		.cpu = this_cpu,
+	};
+
+	if (!sim->__trace)
+		return;
+
+	fwrite(&r, sizeof(r), 1, sim->__trace);
+}
+
+/**
+ * Resources in use are tracked in @sim->__active_resources so that walking
+ * over them does not scan the whole resource table
+ */
+static inline unsigned int __nr_resource_words(unsigned int nr_resources)
+{
+	return (nr_resources + 63) / 64;
+}
+
+/**
+ * Most resources are never waited for in priority order, so the prioq with
+ * its level for each priority is taken from a pool only while it has waiters
+ */
+struct prioq *resource_prio_waitqueue(struct resource *r)
+{
+	if (!r->prio_waitqueue) {
+		r->prio_waitqueue = pool_alloc(&sim->__prioq_pool);
+		prioq_init(r->prio_waitqueue);
+	}
+	return r->prio_waitqueue;
+}
+
+static inline bool __prio_waited(struct resource *r)
+{
+	return r->prio_waitqueue && !prioq_empty(r->prio_waitqueue);
+}
+
+static void __put_prio_waitqueue(struct resource *r)
+{
+	if (!r->prio_waitqueue || !prioq_empty(r->prio_waitqueue))
+		return;
+
+	pool_free(&sim->__prioq_pool, r->prio_waitqueue);
+	r->prio_waitqueue = NULL;
+}
+
+static void __update_active_resource(unsigned int resource_id)
+{
+	struct resource *r = resources + resource_id;
+	unsigned long long bit = 1ULL << (resource_id % 64);
+
+	if (r->owner || !list_empty(&r->waitqueue) || __prio_waited(r)) {
+		sim->__active_resources[resource_id / 64] |= bit;
+	} else {
+		sim->__active_resources[resource_id / 64] &= ~bit;
+	}
+}
+
+/**
+ * # of processes waiting for @resource_id in either of its wait queues
+ */
+static unsigned int __nr_waiters(unsigned int resource_id)
+{
+	struct resource *r = resources + resource_id;
+	struct process *p;
+	unsigned int nr = r->prio_waitqueue ? r->prio_waitqueue->nr_queued : 0;
+
+	list_for_each_entry(p, &r->waitqueue, list) {
+		nr++;
+	}
+	return nr;
+}
+
+/**
+ * Priority inversion is accounted lazily; @sim->__nr_inverted waiters have
+ * been waiting on lower-priority owners since @sim->__inverted_since. This
+ * also covers the ticks skipped by fast-forwarding.
+ */
+static inline void __account_inversion(void)
+{
+	sim->__metrics.inversion_ticks +=
+			(unsigned long long)sim->__nr_inverted * (ticks - sim->__inverted_since);
+	sim->__inverted_since = ticks;
+}
+
+static inline unsigned int __prio_level(struct process *p)
+{
+	return p->prio_orig < MAX_PRIO ? p->prio_orig : MAX_PRIO;
+}
+
+static void __set_inverted(struct resource *r, unsigned int nr)
+{
+	if (nr == r->__nr_inverted)
+		return;
+
+	__account_inversion();
+	sim->__nr_inverted += nr - r->__nr_inverted;
+	r->__nr_inverted = nr;
+}
+
+/**
+ * Count @p in the waiters of @r, which it has just been queued to
+ */
+static void __add_waiter(struct resource *r, struct process *p)
+{
+	unsigned int level = __prio_level(p);
+
+	if (!r->__waiters) {
+		r->__waiters = pool_alloc(&sim->__resource_waiters_pool);
+		memset(r->__waiters, 0x00, sizeof(*r->__waiters));
+	}
+	r->__waiters->nr++;
+	r->__waiters->nr_at[level]++;
+
+	if (r->owner && level > __prio_level(r->owner))
+		__set_inverted(r, r->__nr_inverted + 1);
+}
+
+static void __remove_waiter(struct resource *r, struct process *p)
+{
+	unsigned int level = __prio_level(p);
+
+	r->__waiters->nr--;
+	r->__waiters->nr_at[level]--;
+
+	if (r->owner && level > __prio_level(r->owner))
+		__set_inverted(r, r->__nr_inverted - 1);
+}
+
+/**
+ * Recount the waiters above the owner of @r, which has just changed. The
+ * effective priorities do not count as PIP and PCP raise the owner exactly
+ * to get around the inversion.
+ */
+static void __update_owner(struct resource *r)
+{
+	unsigned int nr = 0;
+
+	if (r->owner && r->__waiters && r->__waiters->nr) {
+		for (unsigned int i = __prio_level(r->owner) + 1; i <= MAX_PRIO; i++) {
+			nr += r->__waiters->nr_at[i];
+		}
+	}
+	__set_inverted(r, nr);
+}
+
+/**
+ * @current has just been blocked on a resource. Follow the wait-for graph
+ * from there; each blocked process waits for the owner of the resource it is
+ * blocked on. Coming back to @current means none of them can ever proceed.
+ * Remember the first such cycle to report it, and to have the main loop stop
+ * with --stop-on-deadlock.
+ */
+static void __detect_deadlock(void)
+{
+	struct process *p = current;
+	unsigned int nr_processes = 0;
+	unsigned int nr_steps = 0;
+
+	if (sim->__deadlocked)
+		return;
+
+	for (unsigned int i = 0; i < NR_CPUS; i++) {
+		nr_processes += sim->__cpus[i].__nr_processes;
+	}
+
+	while (p->status == PROCESS_BLOCKED && p->__cold->__waiting_for != UINT_MAX) {
+		p = resources[p->__cold->__waiting_for].owner;
+		if (!p || ++nr_steps > nr_processes)
+			return;
+		if (p == current)
+			break;
+	}
+	if (p != current)
+		return;
+
+	sim->__deadlocked = current;
+	sim->__deadlocked_at = ticks;
+}
+
+/**
+ * Deadlock reports get in the way of comparing the engine variants with -D
+ */
+static bool __report_deadlocks = true;
+
+/**
+ * Print the cycle __detect_deadlock() has found, after the events and to
+ * where they go. The processes in it never run again, so the cycle is still
+ * there as it was. The report is put together first and written out at once
+ * so that those of the batch jobs running at the same time stay in one piece.
+ */
+static void __report_deadlock(void)
+{
+	struct process *p = sim->__deadlocked;
+	FILE *report;
+	char *text = NULL;
+	size_t size = 0;
+
+	if (!p || !__report_deadlocks)
+		return;
+
+	report = open_memstream(&text, &size);
+	assert(report && "Out of memory");
+
+	if (sim->__script)
+		fprintf(report, "%s: ", sim->__script);
+	fprintf(report, "Deadlock in %s at tick %u:", sim->sched->name, sim->__deadlocked_at);
+	do {
+		unsigned int id = p->__cold->__waiting_for;
+
+		fprintf(report, "%s %d waits for [%u] held by %d", p == sim->__deadlocked ? "" : ",",
+				p->pid, id, resources[id].owner->pid);
+		p = resources[id].owner;
+	} while (p != sim->__deadlocked);
+	fprintf(report, "\n");
+	fclose(report);
+
+	fwrite(text, 1, size, sim->__events_stream ? sim->__events_stream : stderr);
+	free(text);
+}
+
+void dump_status(void)
+{
+	struct process *p;
+
+	/* Keep the events in line with the status on the terminal */
+	__flush_events();
+
+	printf("***** CURRENT *********\n");
+	for (unsigned int i = 0; i < NR_CPUS; i++) {
+		p = sim->__cpus[i].__current;
+		if (!p)
+			continue;
+		if (NR_CPUS > 1)
+			printf("[%d] ", i);
+		printf("%2d (%s): %d + %d/%d at %d\n", p->pid, __process_status_sz[p->status],
+		       p->__cold->__starts_at, p->age, p->lifespan, p->prio);
+	}
+
+	printf("***** READY QUEUE *****\n");
+	for (unsigned int i = 0; i < NR_CPUS; i++) {
+		list_for_each_entry(p, &sim->__cpus[i].__readyqueue, list) {
+			if (NR_CPUS > 1)
+				printf("[%d] ", i);
+			printf("%2d (%s): %d + %d/%d at %d\n", p->pid, __process_status_sz[p->status],
+			       p->__cold->__starts_at, p->age, p->lifespan, p->prio);
+		}
+	}
+
+	printf("***** RESOURCES *******\n");
+	for (unsigned int w = 0; w < __nr_resource_words(NR_RESOURCES); w++) {
+		for (unsigned long long active = sim->__active_resources[w]; active;
+				active &= active - 1) {
+			unsigned int i = w * 64 + __builtin_ctzll(active);
+			struct resource *r = resources + i;
+			int level;
+
+			printf("%2d: owned by ", i);
+			if (r->owner) {
+				printf("%d\n", r->owner->pid);
+			} else {
+				printf("no one\n");
+			}
+
+			list_for_each_entry(p, &r->waitqueue, list) {
+				printf("    %d is waiting\n", p->pid);
+			}
+			if (r->prio_waitqueue) {
+				prioq_for_each_entry(p, r->prio_waitqueue, level) {
+					printf("    %d is waiting\n", p->pid);
+				}
+			}
+		}
+	}
+	printf("\n\n");
+
+	return;
+}
+
+static void __briefing_schedule(struct process *p)
+{
+	struct resource_schedule *rs;
+
+	if (quiet)
+		return;
+
+	printf("- Process %d: Forked at tick %d and run for %d tick%s with initial priority %d\n",
+	       p->pid, p->__cold->__starts_at, p->lifespan, p->lifespan >= 2 ? "s" : "", p->prio);
+
+	list_for_each_entry(rs, &p->__cold->__resources_to_acquire, list) {
+		printf("    Acquire resource [%d] at %d for %d\n", rs->resource_id, rs->at,
+		       rs->duration);
+	}
+}
+
+/**
+ * Stable merge sort of @nr processes in @head on their start ticks
+ */
+static void __sort_by_start(struct list_head *head, unsigned int nr)
+{
+	LIST_HEAD(left);
+	struct list_head *pos = head;
+	struct list_head *l, *r;
+
+	if (nr < 2)
+		return;
+
+	for (unsigned int i = 0; i < nr / 2; i++) {
+		pos = pos->next;
+	}
+	list_cut_position(&left, head, pos);
+
+	__sort_by_start(&left, nr / 2);
+	__sort_by_start(head, nr - nr / 2);
+
+	/* Merge @left into @head. Take from @left on ties to keep the order */
+	r = head->next;
+	while (!list_empty(&left)) {
+		l = left.next;
+		while (r != head &&
+				list_entry(r, struct process, list)->__cold->__starts_at <
+				list_entry(l, struct process, list)->__cold->__starts_at) {
+			r = r->next;
+		}
+		list_move_tail(l, r);
+	}
+}
+
+/**
+ * Order sim->__forkqueue on the start ticks so that __fork_on_schedule() only needs
+ * to look at its head. Processes starting at the same tick keep the order
+ * in the script.
+ */
+static void __sort_forkqueue(void)
+{
+	unsigned int nr = 0;
+	struct list_head *pos;
+
+	list_for_each(pos, &sim->__forkqueue) {
+		nr++;
+	}
+	__sort_by_start(&sim->__forkqueue, nr);
+}
+
+enum script_keyword {
+	KEYWORD_UNKNOWN,
+	KEYWORD_PROCESS,
+	KEYWORD_END,
+	KEYWORD_LIFESPAN,
+	KEYWORD_PRIO,
+	KEYWORD_START,
+	KEYWORD_ACQUIRE,
+};
+
+static inline bool __token_is(const struct token *token, const char *keyword,
+		unsigned int len)
+{
+	return token->len == len && memcmp(token->str, keyword, len) == 0;
+}
+
+/**
+ * Tell the keyword by its first character and length before comparing
+ */
+static enum script_keyword __match_keyword(const struct token *token)
+{
+	switch (token->str[0]) {
+	case 'p':
+		if (__token_is(token, "process", 7))
+			return KEYWORD_PROCESS;
+		if (__token_is(token, "prio", 4))
+			return KEYWORD_PRIO;
+		break;
+	case 'e':
+		if (__token_is(token, "end", 3))
+			return KEYWORD_END;
+		break;
+	case 'l':
+		if (__token_is(token, "lifespan", 8))
+			return KEYWORD_LIFESPAN;
+		break;
+	case 's':
+		if (__token_is(token, "start", 5))
+			return KEYWORD_START;
+		break;
+	case 'a':
+		if (__token_is(token, "acquire", 7))
+			return KEYWORD_ACQUIRE;
+		break;
+	}
+	return KEYWORD_UNKNOWN;
+}
+
+/**
+ * Map the script into memory. Fall back to reading it into a buffer if it
+ * cannot be mapped (e.g., the script is empty or comes through a pipe).
+ * Set @mapped to tell how to dispose the script with __unmap_script().
+ */
+static char *__map_script(char *const filename, size_t *size, bool *mapped)
+{
+	struct stat st;
+	char *script = NULL;
+	size_t len = 0, capacity = 0;
+	ssize_t nr_read;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		script = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (script != MAP_FAILED) {
+			close(fd);
+			*size = st.st_size;
+			*mapped = true;
+			return script;
+		}
+		script = NULL;
+	}
+
+	do {
+		if (len == capacity) {
+			char *grown;
+
+			capacity = capacity ? capacity * 2 : MAX_COMMAND_LEN;
+			grown = realloc(script, capacity);
+			assert(grown && "Out of memory");
+			script = grown;
+		}
+		nr_read = read(fd, script + len, capacity - len);
+		if (nr_read > 0)
+			len += nr_read;
+	} while (nr_read > 0);
+	close(fd);
+
+	*size = len;
+	*mapped = false;
+	return script;
+}
+
+static void __unmap_script(char *script, size_t size, bool mapped)
+{
+	if (mapped) {
+		munmap(script, size);
+	} else {
+		free(script);
+	}
+}
+
+/**
+ * Number of resources to simulate. Given with -R, or otherwise the highest
+ * resource id in the script plus one
+ */
+static unsigned int __resource_limit = 0;
+
+static bool __check_resource_id(long long resource_id)
+{
+	unsigned int limit = __resource_limit ? __resource_limit : MAX_RESOURCES;
+
+	if (resource_id < 0 || resource_id >= limit) {
+		fprintf(stderr, "Resource id %lld is out of range [0, %u)\n", resource_id, limit);
+		return false;
+	}
+
+	if (resource_id >= sim->__nr_resources_used)
+		sim->__nr_resources_used = resource_id + 1;
+	return true;
+}
+
+static inline struct process *__alloc_process(void)
+{
+	struct process *p = pool_alloc(&sim->__process_pool);
+	struct process_cold *cold = pool_alloc(&sim->__process_cold_pool);
+
+	memset(p, 0x00, sizeof(*p));
+	memset(cold, 0x00, sizeof(*cold));
+	cold->__waiting_for = UINT_MAX;
+	p->__cold = cold;
+
+	INIT_LIST_HEAD(&p->list);
+	INIT_LIST_HEAD(&p->holding);
+	INIT_LIST_HEAD(&cold->__resources_to_acquire);
+	INIT_LIST_HEAD(&cold->__resources_holding);
+	return p;
+}
+
+static inline void __free_process(struct process *p)
+{
+	pool_free(&sim->__process_cold_pool, p->__cold);
+	pool_free(&sim->__process_pool, p);
+}
+
+/**
+ * Check that the tables in @image fill it exactly. The counts in the header
+ * are not trusted, so the size is divided by them rather than multiplied
+ */
+static bool __check_workload(const char *image, size_t size)
+{
+	const struct workload_header *header = (const void *)image;
+	size_t rest;
+
+	if (size < sizeof(*header) || header->version != WORKLOAD_VERSION)
+		goto corrupted;
+
+	rest = size - sizeof(*header);
+	if (rest / sizeof(struct workload_process) < header->nr_processes)
+		goto corrupted;
+
+	rest -= sizeof(struct workload_process) * header->nr_processes;
+	if (rest % sizeof(struct workload_schedule) ||
+			rest / sizeof(struct workload_schedule) != header->nr_schedules)
+		goto corrupted;
+
+	return true;
+
+corrupted:
+	fprintf(stderr, "Corrupted workload image\n");
+	return false;
+}
+
+/**
+ * Materialize the @index-th process in the workload image @image, which has
+ * passed __check_workload(). Return NULL if the process is broken
+ */
+static struct process *__load_workload_process(const char *image, uint32_t index)
+{
+	const struct workload_header *header = (const void *)image;
+	const struct workload_process *table = (const void *)(header + 1);
+	const struct workload_process *wp = table + index;
+	const struct workload_schedule *ws = (const void *)(table + header->nr_processes);
+	struct process *p;
+
+	if (wp->first_schedule > header->nr_schedules ||
+			wp->nr_schedules > header->nr_schedules - wp->first_schedule) {
+		fprintf(stderr, "Corrupted workload image\n");
+		return NULL;
+	}
+
+	p = __alloc_process();
+	p->pid = wp->pid;
+	p->__cold->__starts_at = wp->starts_at;
+	p->lifespan = wp->lifespan;
+	p->prio = p->prio_orig = wp->prio;
+
+	for (uint32_t j = 0; j < wp->nr_schedules; j++) {
+		const struct workload_schedule *s = ws + wp->first_schedule + j;
+		struct resource_schedule *rs;
+
+		if (!__check_resource_id(s->resource_id))
+			return NULL;
+
+		rs = pool_alloc(&sim->__resource_schedule_pool);
+
+		*rs = (struct resource_schedule) {
+			.resource_id = s->resource_id,
+			.at = s->at,
+			.duration = s->duration,
+		};
+		list_add_tail(&rs->list, &p->__cold->__resources_to_acquire);
+	}
+	return p;
+}
+
+/**
+ * Build sim->__forkqueue from the precompiled workload image in @image.
+ * See workload.h for the layout.
+ */
+static int __load_workload(const char *image, size_t size)
+{
+	const struct workload_header *header = (const void *)image;
+
+	if (!__check_workload(image, size))
+		return false;
+
+	for (uint32_t i = 0; i < header->nr_processes; i++) {
+		struct process *p = __load_workload_process(image, i);
+
+		if (!p)
+			return false;
+
+		list_add_tail(&p->list, &sim->__forkqueue);
+
+		__briefing_schedule(p);
+	}
+
+	return true;
+}
+
+/**
+ * Write the processes in sim->__forkqueue into @filename as a workload image
+ */
+static int __write_workload(char *const filename)
+{
+	struct workload_header header = {
+		.version = WORKLOAD_VERSION,
+	};
+	struct process *p;
+	struct resource_schedule *rs;
+	FILE *file = fopen(filename, "wb");
+
+	if (!file) {
+		fprintf(stderr, "Cannot open %s\n", filename);
+		return false;
+	}
+
+	memcpy(header.magic, WORKLOAD_MAGIC, sizeof(header.magic));
+	list_for_each_entry(p, &sim->__forkqueue, list) {
+		header.nr_processes++;
+		list_for_each_entry(rs, &p->__cold->__resources_to_acquire, list) {
+			header.nr_schedules++;
+		}
+	}
+	fwrite(&header, sizeof(header), 1, file);
+
+	header.nr_schedules = 0;
+	list_for_each_entry(p, &sim->__forkqueue, list) {
+		struct workload_process wp = {
+			.pid = p->pid,
+			.starts_at = p->__cold->__starts_at,
+			.lifespan = p->lifespan,
+			.prio = p->prio_orig,
+			.first_schedule = header.nr_schedules,
+		};
+
+		list_for_each_entry(rs, &p->__cold->__resources_to_acquire, list) {
+			wp.nr_schedules++;
+		}
+		header.nr_schedules += wp.nr_schedules;
+		fwrite(&wp, sizeof(wp), 1, file);
+	}
+
+	list_for_each_entry(p, &sim->__forkqueue, list) {
+		list_for_each_entry(rs, &p->__cold->__resources_to_acquire, list) {
+			struct workload_schedule ws = {
+				.resource_id = rs->resource_id,
+				.at = rs->at,
+				.duration = rs->duration,
+			};
+			fwrite(&ws, sizeof(ws), 1, file);
+		}
+	}
+
+	if (fclose(file)) {
+		fprintf(stderr, "Cannot write %s\n", filename);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Apply the script line in @tokens to the process *@p being described, and
+ * start a new one on "process". Return 1 if the line ends the description of
+ * *@p, 0 if not, or -1 if the line is broken
+ */
+static int __parse_property(struct process **p, const struct token *tokens, int nr_tokens)
+{
+	switch (__match_keyword(tokens)) {
+	case KEYWORD_PROCESS:
+		assert(nr_tokens == 2);
+		/* Start processor description */
+		*p = __alloc_process();
+		(*p)->pid = parse_int(tokens + 1);
+		return 0;
+
+	case KEYWORD_END:
+		/* End of process description */
+		assert(*p);
+		return 1;
+
+	case KEYWORD_LIFESPAN:
+		assert(nr_tokens == 2);
+		(*p)->lifespan = parse_int(tokens + 1);
+		return 0;
+
+	case KEYWORD_PRIO:
+		assert(nr_tokens == 2);
+		(*p)->prio = (*p)->prio_orig = parse_int(tokens + 1);
+		return 0;
+
+	case KEYWORD_START:
+		assert(nr_tokens == 2);
+		(*p)->__cold->__starts_at = parse_int(tokens + 1);
+		return 0;
+
+	case KEYWORD_ACQUIRE: {
+		struct resource_schedule *rs;
+		int resource_id;
+		assert(nr_tokens == 4);
+
+		resource_id = parse_int(tokens + 1);
+		if (!__check_resource_id(resource_id))
+			return -1;
+
+		rs = pool_alloc(&sim->__resource_schedule_pool);
+
+		*rs = (struct resource_schedule) {
+			.resource_id = resource_id,
+			.at = parse_int(tokens + 2),
+			.duration = parse_int(tokens + 3),
+		};
+
+		list_add_tail(&rs->list, &(*p)->__cold->__resources_to_acquire);
+		return 0;
+	}
+
+	default:
+		fprintf(stderr, "Unknown property %.*s\n", tokens[0].len, tokens[0].str);
+		return -1;
+	}
+}
+
+static int __load_script(char *const filename)
+{
+	struct process *p = NULL;
+	const char *pos, *end;
+	size_t size;
+	bool mapped;
+	char *script = __map_script(filename, &size, &mapped);
+
+	if (!script) {
+		fprintf(stderr, "Cannot open %s\n", filename);
+		return false;
+	}
+
+	if (size >= sizeof(struct workload_header) &&
+			memcmp(script, WORKLOAD_MAGIC, strlen(WORKLOAD_MAGIC)) == 0) {
+		int loaded = __load_workload(script, size);
+
+		__unmap_script(script, size, mapped);
+		if (loaded && !quiet)
+			printf("\n");
+		return loaded;
+	}
+
+	pos = script;
+	end = script + size;
+	while (pos < end) {
+		struct token tokens[MAX_NR_TOKENS];
+		int nr_tokens = parse_line(&pos, end, tokens);
+
+		if (nr_tokens == 0)
+			continue;
+
+		switch (__parse_property(&p, tokens, nr_tokens)) {
+		case 1:
+			list_add_tail(&p->list, &sim->__forkqueue);
+
+			__briefing_schedule(p);
+			p = NULL;
+			break;
+		case -1:
+			__unmap_script(script, size, mapped);
+			return false;
+		}
+	}
+	__unmap_script(script, size, mapped);
+	if (!quiet)
+		printf("\n");
+
+	return true;
+}
+
+/***********************************************************************
+ * Streaming the workload
+ *
+ * DESCRIPTION
+ *   With --stream, the script or the workload image is not loaded up front
+ *   but read along with the simulation. Only the processes starting in
+ *   @lookahead ticks from now, and the one right after them, are in
+ *   sim->__forkqueue, and exited processes go back to the pool, so the
+ *   memory is bounded by the number of live processes rather than by the
+ *   length of the workload. The processes should come in the order of their
+ *   start ticks since they cannot be sorted.
+ */
+struct workload_stream {
+	FILE *file;					/* The script. NULL when streaming an image */
+	char *line;					/* The line being parsed */
+	size_t line_size;
+	struct process *process;	/* The process being described in the script */
+
+	char *image;				/* The mapped workload image */
+	size_t image_size;
+	bool mapped;
+	uint32_t next;				/* Index of the next process in @image */
+
+	unsigned int lookahead;
+	unsigned int last_start;	/* When the last process read starts */
+	bool done;
+};
+
+/**
+ * The next process described in the script. Return NULL at the end of the
+ * script or on an error, telling them apart with @done
+ */
+static struct process *__stream_script(struct workload_stream *s)
+{
+	ssize_t len;
+
+	while ((len = getline(&s->line, &s->line_size, s->file)) > 0) {
+		struct token tokens[MAX_NR_TOKENS];
+		const char *pos = s->line;
+		int nr_tokens = parse_line(&pos, s->line + len, tokens);
+
+		if (nr_tokens == 0)
+			continue;
+
+		switch (__parse_property(&s->process, tokens, nr_tokens)) {
+		case 1: {
+			struct process *p = s->process;
+
+			s->process = NULL;
+			return p;
+		}
+		case -1:
+			return NULL;
+		}
+	}
+	s->done = true;
+	return NULL;
+}
+
+static struct process *__stream_image(struct workload_stream *s)
+{
+	const struct workload_header *header = (const void *)s->image;
+
+	if (s->next == header->nr_processes) {
+		s->done = true;
+		return NULL;
+	}
+	return __load_workload_process(s->image, s->next++);
+}
+
+/**
+ * Read the processes starting in @lookahead ticks from now, and the one after
+ * them so that __next_fork_at() knows when to fork next, into
+ * sim->__forkqueue. Return false if the workload is broken
+ */
+static bool __stream_workload(void)
+{
+	struct workload_stream *s = sim->__stream;
+	unsigned long long horizon = (unsigned long long)ticks + s->lookahead;
+
+	while (!s->done) {
+		struct process *p;
+
+		if (!list_empty(&sim->__forkqueue) &&
+				list_last_entry(&sim->__forkqueue, struct process, list)->__cold->__starts_at > horizon)
+			break;
+
+		p = s->file ? __stream_script(s) : __stream_image(s);
+		if (!p) {
+			if (s->done)
+				break;
+			return false;
+		}
+
+		if (p->__cold->__starts_at < s->last_start) {
+			fprintf(stderr, "Process %d starts at %u, before the previous one at %u. "
+					"Processes should be in the order of their start ticks to stream\n",
+					p->pid, p->__cold->__starts_at, s->last_start);
+			return false;
+		}
+		s->last_start = p->__cold->__starts_at;
+
+		/* The table grows with the highest resource id seen, doubling at least */
+		if (sim->__nr_resources_used > NR_RESOURCES) {
+			unsigned int nr_resources = NR_RESOURCES * 2;
+
+			if (nr_resources < sim->__nr_resources_used)
+				nr_resources = sim->__nr_resources_used;
+			if (nr_resources > MAX_RESOURCES)
+				nr_resources = MAX_RESOURCES;
+			sim_grow_resources(sim, nr_resources);
+		}
+
+		list_add_tail(&p->list, &sim->__forkqueue);
+	}
+	return true;
+}
+
+static struct workload_stream *__open_stream(char *const filename, unsigned int lookahead)
+{
+	struct workload_stream *s = calloc(1, sizeof(*s));
+	ssize_t len;
+
+	assert(s && "Out of memory");
+	s->lookahead = lookahead;
+
+	s->file = fopen(filename, "r");
+	if (!s->file) {
+		fprintf(stderr, "Cannot open %s\n", filename);
+		free(s);
+		return NULL;
+	}
+
+	/* Images are mapped and walked through instead of being read */
+	len = getline(&s->line, &s->line_size, s->file);
+	if (len >= (ssize_t)strlen(WORKLOAD_MAGIC) &&
+			memcmp(s->line, WORKLOAD_MAGIC, strlen(WORKLOAD_MAGIC)) == 0) {
+		fclose(s->file);
+		s->file = NULL;
+
+		s->image = __map_script(filename, &s->image_size, &s->mapped);
+		if (!s->image || s->image_size < sizeof(struct workload_header) ||
+				!__check_workload(s->image, s->image_size)) {
+			if (s->image)
+				__unmap_script(s->image, s->image_size, s->mapped);
+			free(s->line);
+			free(s);
+			return NULL;
+		}
+		return s;
+	}
+
+	/* Parse the line taken to tell the kind of the workload */
+	if (len > 0) {
+		struct token tokens[MAX_NR_TOKENS];
+		const char *pos = s->line;
+		int nr_tokens = parse_line(&pos, s->line + len, tokens);
+
+		if (nr_tokens && __parse_property(&s->process, tokens, nr_tokens) < 0) {
+			fclose(s->file);
+			free(s->line);
+			free(s);
+			return NULL;
+		}
+	}
+	return s;
+}
+
+static void __close_stream(struct workload_stream *s)
+{
+	if (s->file)
+		fclose(s->file);
+	if (s->image)
+		__unmap_script(s->image, s->image_size, s->mapped);
+	free(s->line);
+	free(s);
+}
+
+/**
+ * Move the home of @p to @cpu
+ */
+static inline void __rehome_process(struct process *p, struct sim_cpu *cpu)
+{
+	sim->__cpus[p->__cpu].__nr_processes--;
+	p->__cpu = cpu - sim->__cpus;
+	cpu->__nr_processes++;
+}
+
+/**
+ * The CPU with the fewest processes, which a newly forked process goes to
+ */
+static struct sim_cpu *__idlest_cpu(void)
+{
+	struct sim_cpu *idlest = sim->__cpus;
+
+	for (unsigned int i = 1; i < NR_CPUS; i++) {
+		if (sim->__cpus[i].__nr_processes < idlest->__nr_processes)
+			idlest = sim->__cpus + i;
+	}
+	return idlest;
+}
+
+/**
+ * Order the schedules of @p to acquire on @at, keeping the order in the
+ * script among those at the same age. The ones due are then at the head, and
+ * __run_current_acquire() only needs to look there. Schedules usually come
+ * in order already, which makes it a single pass.
+ */
+static void __sort_acquires(struct process *p)
+{
+	struct list_head *head = &p->__cold->__resources_to_acquire;
+	struct list_head *pos, *next;
+
+	for (pos = head->next->next; pos != head; pos = next) {
+		struct resource_schedule *rs = list_entry(pos, struct resource_schedule, list);
+		struct list_head *prev = pos->prev;
+
+		next = pos->next;
+		while (prev != head && list_entry(prev, struct resource_schedule, list)->at > rs->at) {
+			prev = prev->prev;
+		}
+		if (prev != pos->prev)
+			list_move(pos, prev);
+	}
+}
+
+/**
+ * Put @rs that @p has just acquired into @p->__cold->__resources_holding, which is
+ * ordered on @release_at and then on the order of acquisition
+ */
+static void __hold_schedule(struct process *p, struct resource_schedule *rs)
+{
+	struct list_head *head = &p->__cold->__resources_holding;
+	struct list_head *prev = head->prev;
+
+	while (prev != head &&
+			list_entry(prev, struct resource_schedule, list)->release_at > rs->release_at) {
+		prev = prev->prev;
+	}
+	list_move(&rs->list, prev);
+}
+
+/***********************************************************************
+ * The functions on the way of each tick take the scheduler as @s rather than
+ * looking it up in @sim. With CONFIG_SPECIALIZE, they are all inlined into
+ * __do_simulation(), which is instantiated for each scheduler with its
+ * address as @s (see __specialized). The compiler then turns the callbacks
+ * into direct calls that it can inline as well, and drops the checks of the
+ * callbacks the scheduler does not implement.
+ */
+#ifdef CONFIG_SPECIALIZE
+#define __tick_inline	inline __attribute__((always_inline))
+#else
+#define __tick_inline
+#endif
+
+/**
+ * Fork process on schedule
+ */
+static __tick_inline int __fork_on_schedule(const struct scheduler *s)
+{
+	int nr_forked = 0;
+
+	while (!list_empty(&sim->__forkqueue)) {
+		struct process *p = list_first_entry(&sim->__forkqueue, struct process, list);
+
+		if (p->__cold->__starts_at > ticks)
+			break;
+
+		sim->__cpu = __idlest_cpu();
+		p->__cpu = this_cpu;
+		sim->__cpu->__nr_processes++;
+
+		p->__cold->__first_run_at = p->__cold->__blocked_at = UINT_MAX;
+		__sort_acquires(p);
+
+		list_move_tail(&p->list, &readyqueue);
+		p->status = PROCESS_READY;
+		__print_event(p->pid, "N");
+		__trace_event(TRACE_FORK, p, 0);
+		if (s->forked)
+			PROFILED(&sim->__profile, PROFILE_FORKED, s->forked(p));
+		nr_forked++;
+	}
+	return nr_forked;
+}
+
+/**
+ * Exit the process
+ */
+static __tick_inline void __exit_process(const struct scheduler *s, struct process *p)
+{
+	/* Make sure the process is not attached to some list head */
+	assert(list_empty(&p->list));
+
+	/* Make sure the process is not holding any resource */
+	assert(list_empty(&p->__cold->__resources_holding));
+
+	/* Make sure there is no pending resource to acquire */
+	assert(list_empty(&p->__cold->__resources_to_acquire));
+
+	if (s->exiting)
+		PROFILED(&sim->__profile, PROFILE_EXITING, s->exiting(p));
+
+	sim->__cpus[p->__cpu].__nr_processes--;
+
+	/* The records would pile up as the workload streams. Keep them only for -M */
+	if (!sim->__stream || print_metrics) {
+		metrics_add(&sim->__metrics, &(struct metrics_record) {
+			.pid = p->pid,
+			.starts_at = p->__cold->__starts_at,
+			.lifespan = p->lifespan,
+			.first_run_at = p->__cold->__first_run_at,
+			.exit_at = ticks,
+			.blocked_ticks = p->__cold->__blocked_ticks,
+			.nr_preemptions = p->__cold->__nr_preemptions,
+		});
+	}
+
+	__print_event(p->pid, "X");
+	__trace_event(TRACE_EXIT, p, 0);
+
+	__free_process(p);
+}
+
+/**
+ * Process resource acqutision
+ */
+static __tick_inline bool __run_current_acquire(const struct scheduler *s)
+{
+	/* The schedules are sorted on @at, so the ones due are at the head */
+	while (!list_empty(&current->__cold->__resources_to_acquire)) {
+		struct resource_schedule *rs = list_first_entry(&current->__cold->__resources_to_acquire,
+				struct resource_schedule, list);
+		bool acquired;
+
+		if (rs->at != current->age)
+			break;
+
+		assert(s->acquire && "scheduler.acquire() not implemented");
+
+		/* Callback to acquire the resource */
+		profile_sample(&sim->__profile, PROFILE_NR_WAITERS, __nr_waiters(rs->resource_id));
+		PROFILED(&sim->__profile, PROFILE_ACQUIRE,
+				acquired = s->acquire(rs->resource_id));
+		if (!acquired) {
+			__update_active_resource(rs->resource_id);
+			__add_waiter(resources + rs->resource_id, current);
+			current->__cold->__waiting_for = rs->resource_id;
+			current->__cold->__blocked_at = ticks;
+			__print_event(current->pid, "=[%d]", rs->resource_id);
+			__trace_event(TRACE_BLOCK, current, rs->resource_id);
+			__detect_deadlock();
+			return false;
+		}
+
+		__update_active_resource(rs->resource_id);
+		__update_owner(resources + rs->resource_id);
+		rs->release_at = rs->at + rs->duration;
+		__hold_schedule(current, rs);
+
+		__print_event(current->pid, "+[%d]", rs->resource_id);
+		__trace_event(TRACE_ACQUIRE, current, rs->resource_id);
+	}
+
+	return true;
+}
+
+/**
+ * Account the blocked ticks of @p, which is not blocked any longer
+ */
+static inline void __account_unblocked(struct process *p)
+{
+	if (p->__cold->__blocked_at == UINT_MAX)
+		return;
+
+	p->__cold->__blocked_ticks += ticks - p->__cold->__blocked_at;
+	p->__cold->__blocked_at = UINT_MAX;
+}
+
+/**
+ * release() puts the waiter it wakes up at the tail of @readyqueue
+ */
+static inline void __account_wakeup(unsigned int resource_id)
+{
+	struct process *p;
+
+	if (list_empty(&readyqueue))
+		return;
+
+	p = list_last_entry(&readyqueue, struct process, list);
+	__account_unblocked(p);
+
+	if (p->__cold->__waiting_for == resource_id && p->status != PROCESS_BLOCKED) {
+		__remove_waiter(resources + resource_id, p);
+		p->__cold->__waiting_for = UINT_MAX;
+	}
+}
+
+/**
+ * Process resource release
+ */
+static __tick_inline void __run_current_release(const struct scheduler *s)
+{
+	/* Ordered on @release_at, so the ones expiring at this age are at the head */
+	while (!list_empty(&current->__cold->__resources_holding)) {
+		struct resource_schedule *rs = list_first_entry(&current->__cold->__resources_holding,
+				struct resource_schedule, list);
+
+		if (rs->release_at != current->age)
+			break;
+
+		assert(s->release && "scheduler.release() not implemented");
+
+		/* Callback the release() */
+		profile_sample(&sim->__profile, PROFILE_NR_WAITERS, __nr_waiters(rs->resource_id));
+		PROFILED(&sim->__profile, PROFILE_RELEASE, s->release(rs->resource_id));
+		__put_prio_waitqueue(resources + rs->resource_id);
+		__update_active_resource(rs->resource_id);
+		__account_wakeup(rs->resource_id);
+		__update_owner(resources + rs->resource_id);
+
+		__print_event(current->pid, "-[%d]", rs->resource_id);
+		__trace_event(TRACE_RELEASE, current, rs->resource_id);
+
+		list_del(&rs->list);
+		pool_free(&sim->__resource_schedule_pool, rs);
+	}
+}
+
+/**
+ * The tick at which the next process in sim->__forkqueue is forked.
+ * Return UINT_MAX if there is no more process to fork.
+ */
+static unsigned int __next_fork_at(void)
+{
+	if (list_empty(&sim->__forkqueue))
+		return UINT_MAX;
+
+	return list_first_entry(&sim->__forkqueue, struct process, list)->__cold->__starts_at;
+}
+
+/**
+ * Count the ticks from now on through which @current would just age under a
+ * non-preemptive scheduler; no fork, no acquisition, no release, no exit.
+ */
+static unsigned int __count_plain_ticks(void)
+{
+	struct resource_schedule *rs;
+	unsigned int nr_ticks = current->lifespan - current->age;
+	unsigned int next_fork_at = __next_fork_at();
+
+	if (next_fork_at - ticks < nr_ticks)
+		nr_ticks = next_fork_at - ticks;
+
+	if (!list_empty(&current->__cold->__resources_to_acquire)) {
+		rs = list_first_entry(&current->__cold->__resources_to_acquire, struct resource_schedule, list);
+		if (rs->at >= current->age && rs->at - current->age < nr_ticks)
+			nr_ticks = rs->at - current->age;
+	}
+
+	if (!list_empty(&current->__cold->__resources_holding)) {
+		rs = list_first_entry(&current->__cold->__resources_holding, struct resource_schedule, list);
+		if (rs->release_at - current->age - 1 < nr_ticks)
+			nr_ticks = rs->release_at - current->age - 1;
+	}
+
+	return nr_ticks;
+}
+
+/**
+ * Run @current over the plain ticks at once. This yields the same result as
+ * going through the main loop for each of them since the scheduler would
+ * pick @current again and nothing else would happen.
+ */
+static void __fastforward_current(void)
+{
+	unsigned int nr_ticks = __count_plain_ticks();
+
+	if (!nr_ticks)
+		return;
+
+	for (unsigned int i = 0; i < nr_ticks; i++) {
+		__print_event(current->pid, "%d", current->pid);
+		__trace_event(TRACE_RUN, current, 0);
+		ticks++;
+	}
+	current->age += nr_ticks;
+	sim->__metrics.busy_ticks += nr_ticks;
+}
+
+/**
+ * Stay idle until the next process is forked. Nothing can be ready meanwhile
+ * as no process is running to release resources.
+ */
+static void __fastforward_idle(void)
+{
+	unsigned int next_fork_at = __next_fork_at();
+
+	while (ticks + 1 < next_fork_at) {
+		ticks++;
+		__print_event(0, "idle");
+		__trace_event(TRACE_IDLE, NULL, 0);
+		sim->__metrics.idle_ticks++;
+	}
+}
+
+/**
+ * Take a ready process from @victim for @thief. Return NULL if @victim has
+ * nothing to hand over.
+ */
+static __tick_inline struct process *__steal_from(const struct scheduler *s,
+		struct sim_cpu *victim, struct sim_cpu *thief)
+{
+	struct process *p = NULL;
+
+	sim->__cpu = victim;
+	if (s->steal) {
+		PROFILED(&sim->__profile, PROFILE_STEAL, p = s->steal());
+	} else if (!list_empty(&readyqueue)) {
+		p = list_first_entry(&readyqueue, struct process, list);
+		list_del_init(&p->list);
+	}
+	sim->__cpu = thief;
+
+	if (p)
+		__rehome_process(p, thief);
+	return p;
+}
+
+/**
+ * Pull a ready process over to the CPU being simulated, which has run out of
+ * processes to run. The busiest CPU is looked at first, and the others next.
+ */
+static __tick_inline struct process *__steal(const struct scheduler *s)
+{
+	struct sim_cpu *thief = sim->__cpu;
+	struct sim_cpu *busiest = NULL;
+	struct process *p;
+
+	for (unsigned int i = 0; i < NR_CPUS; i++) {
+		struct sim_cpu *cpu = sim->__cpus + i;
+
+		if (cpu != thief && cpu->__nr_processes &&
+				(!busiest || cpu->__nr_processes > busiest->__nr_processes))
+			busiest = cpu;
+	}
+	if (!busiest)
+		return NULL;
+
+	if ((p = __steal_from(s, busiest, thief)))
+		return p;
+
+	for (unsigned int i = 0; i < NR_CPUS; i++) {
+		struct sim_cpu *cpu = sim->__cpus + i;
+
+		if (cpu != thief && cpu != busiest && (p = __steal_from(s, cpu, thief)))
+			return p;
+	}
+	return NULL;
+}
+
+/**
+ * Run the CPU @sim->__cpu points to for a tick
+ */
+static __tick_inline void __run_cpu(const struct scheduler *s)
+{
+	struct process *prev;
+
+	/**
+	 * @current blocked in the previous tick may have been woken up by a
+	 * later CPU in the same tick, and it is in the ready queue of that CPU
+	 * now. Leave it to that CPU.
+	 */
+	if (current && current->status == PROCESS_READY)
+		current = NULL;
+
+	/* Ask scheduler to pick the next process to run */
+	prev = current;
+	profile_sample(&sim->__profile, PROFILE_NR_PROCESSES, sim->__cpu->__nr_processes);
+	PROFILED(&sim->__profile, PROFILE_SCHEDULE, current = s->schedule());
+
+	/* Nothing to run on this CPU. Try pulling one from the others */
+	if (!current && NR_CPUS > 1) {
+		struct process *p = __steal(s);
+
+		if (p) {
+			list_add_tail(&p->list, &readyqueue);
+			profile_sample(&sim->__profile, PROFILE_NR_PROCESSES, sim->__cpu->__nr_processes);
+			PROFILED(&sim->__profile, PROFILE_SCHEDULE, current = s->schedule());
+		}
+	}
+
+	if (current && current != prev) {
+		sim->__metrics.nr_context_switches++;
+		if (current->__cold->__first_run_at == UINT_MAX)
+			current->__cold->__first_run_at = ticks;
+		__account_unblocked(current);
+	}
+
+	/* If the CPU has run a process in the previous tick */
+	if (prev) {
+		/* Update the process status */
+		if (prev->status == PROCESS_RUNNING) {
+			prev->status = PROCESS_READY;
+			if (prev != current && prev->age < prev->lifespan)
+				prev->__cold->__nr_preemptions++;
+		}
+
+		/* Decommission it if completed */
+		if (prev->age == prev->lifespan) {
+			prev->status = PROCESS_EXIT;
+			__exit_process(s, prev);
+		}
+	}
+
+	/* No process is ready to run on this CPU at this moment */
+	if (!current)
+		return;
+
+	/* A process woken up by another CPU comes to live here */
+	if (current->__cpu != this_cpu)
+		__rehome_process(current, sim->__cpu);
+
+	/* Execute the current process */
+	current->status = PROCESS_RUNNING;
+
+	/* Ensure that @current is detached from any list */
+	assert(list_empty(&current->list));
+
+	/* Try acquiring scheduled resources */
+	if (__run_current_acquire(s)) {
+		/* Succesfully acquired all the resources to make a progress */
+		__print_event(current->pid, "%d", current->pid);
+		__trace_event(TRACE_RUN, current, 0);
+
+		/* So, it ages by one tick */
+		current->age++;
+		sim->__metrics.busy_ticks++;
+
+		/* And performs scheduled releases */
+		__run_current_release(s);
+	} else {
+		/**
+		 * The current is blocked while acquiring resource(s).
+		 * In this case, @current could not make a progress in this tick.
+		 * Thus, it does not get aged nor is unable to perform releases
+		 */
+	}
+}
+
+/**
+ * Whether every CPU is idle with nothing to run
+ */
+static bool __all_cpus_idle(void)
+{
+	for (unsigned int i = 0; i < NR_CPUS; i++) {
+		struct sim_cpu *cpu = sim->__cpus + i;
+
+		if (cpu->__current || !list_empty(&cpu->__readyqueue))
+			return false;
+	}
+	return true;
+}
+
+/***********************************************************************
+ * Checkpoints
+ *
+ * The whole state of the simulation is saved at the beginning of every
+ * @__checkpoint_every ticks into @__checkpoint_dir/<option of the scheduler>.<tick>,
+ * and --resume-from picks the simulation up from the latest one at or before
+ * the given tick. See checkpoint.h for the format.
+ */
+static unsigned int __checkpoint_every = 0;
+static const char *__checkpoint_dir = ".";
+
+/**
+ * The schedules holding are saved with the duration remaining at @age
+ */
+static void __write_schedules(struct checkpoint *c, struct list_head *list, bool holding,
+		unsigned int age)
+{
+	struct resource_schedule *rs;
+
+	list_for_each_entry(rs, list, list) {
+		struct workload_schedule ws = {
+			.resource_id = rs->resource_id,
+			.at = rs->at,
+			.duration = holding ? rs->release_at - age : rs->duration,
+		};
+		checkpoint_write(c, &ws, sizeof(ws));
+	}
+}
+
+static bool __read_schedules(struct checkpoint *c, struct list_head *list, unsigned int nr,
+		bool holding, unsigned int age)
+{
+	for (unsigned int i = 0; i < nr; i++) {
+		struct workload_schedule ws;
+		struct resource_schedule *rs;
+
+		checkpoint_read(c, &ws, sizeof(ws));
+		if (c->failed || ws.resource_id >= NR_RESOURCES)
+			return false;
+
+		rs = pool_alloc(&sim->__resource_schedule_pool);
+		*rs = (struct resource_schedule) {
+			.resource_id = ws.resource_id,
+			.at = ws.at,
+			.duration = ws.duration,
+			.release_at = holding ? age + ws.duration : 0,
+		};
+		list_add_tail(&rs->list, list);
+	}
+	return true;
+}
+
+static inline unsigned int __list_length(struct list_head *head)
+{
+	struct list_head *pos;
+	unsigned int nr = 0;
+
+	list_for_each(pos, head) {
+		nr++;
+	}
+	return nr;
+}
+
+static void __write_process_list(struct checkpoint *c, struct list_head *head)
+{
+	struct process *p;
+
+	checkpoint_write_u32(c, __list_length(head));
+	list_for_each_entry(p, head, list) {
+		checkpoint_write_process(c, p);
+	}
+}
+
+static bool __read_process_list(struct checkpoint *c, struct list_head *head)
+{
+	unsigned int nr = checkpoint_read_u32(c);
+
+	for (unsigned int i = 0; i < nr && !c->failed; i++) {
+		struct process *p = checkpoint_read_process(c);
+
+		if (!p || !list_empty(&p->list))
+			return false;
+		list_add_tail(&p->list, head);
+	}
+	return !c->failed;
+}
+
+/**
+ * Where the processes are. Processes are numbered as they show up here
+ */
+static void __write_locations(struct checkpoint *c)
+{
+	unsigned int nr_active = 0;
+
+	for (unsigned int i = 0; i < NR_CPUS; i++) {
+		sim->__cpu = sim->__cpus + i;
+
+		checkpoint_write_process(c, current);
+		__write_process_list(c, &readyqueue);
+		checkpoint_write_u32(c, sim->__cpu->__nr_processes);
+		if (sim->sched->checkpoint)
+			sim->sched->checkpoint(c);
+	}
+
+	for (unsigned int i = 0; i < __nr_resource_words(NR_RESOURCES); i++) {
+		nr_active += __builtin_popcountll(sim->__active_resources[i]);
+	}
+	checkpoint_write_u32(c, nr_active);
+
+	for (unsigned int i = 0; i < NR_RESOURCES; i++) {
+		struct resource *r = resources + i;
+
+		if (!(sim->__active_resources[i / 64] & (1ULL << (i % 64))))
+			continue;
+
+		checkpoint_write_u32(c, i);
+		checkpoint_write_process(c, r->owner);
+		__write_process_list(c, &r->waitqueue);
+		if (r->prio_waitqueue) {
+			prioq_checkpoint(r->prio_waitqueue, c);
+		} else {
+			struct prioq empty;
+
+			prioq_init(&empty);
+			prioq_checkpoint(&empty, c);
+		}
+	}
+
+	__write_process_list(c, &sim->__forkqueue);
+}
+
+static void __write_process(struct checkpoint *c, struct process *p)
+{
+	struct checkpoint_process cp = {
+		.pid = p->pid,
+		.status = p->status,
+		.age = p->age,
+		.lifespan = p->lifespan,
+		.prio = p->prio,
+		.prio_orig = p->prio_orig,
+		.starts_at = p->__cold->__starts_at,
+		.cpu = p->__cpu,
+		.blocked_on = p->blocked_on ? p->blocked_on - resources : CHECKPOINT_NONE,
+		.nr_to_acquire = __list_length(&p->__cold->__resources_to_acquire),
+		.nr_holding = __list_length(&p->__cold->__resources_holding),
+		.nr_held = __list_length(&p->holding),
+		.first_run_at = p->__cold->__first_run_at,
+		.blocked_at = p->__cold->__blocked_at,
+		.blocked_ticks = p->__cold->__blocked_ticks,
+		.nr_preemptions = p->__cold->__nr_preemptions,
+		.waiting_for = p->__cold->__waiting_for,
+	};
+	struct resource *r;
+
+	memcpy(cp.queue_state, p->__queue_state, sizeof(cp.queue_state));
+
+	checkpoint_write(c, &cp, sizeof(cp));
+	__write_schedules(c, &p->__cold->__resources_to_acquire, false, p->age);
+	__write_schedules(c, &p->__cold->__resources_holding, true, p->age);
+	list_for_each_entry(r, &p->holding, held) {
+		checkpoint_write_u32(c, r - resources);
+	}
+}
+
+static void __write_checkpoint(void)
+{
+	char filename[MAX_COMMAND_LEN];
+	struct checkpoint_header header;
+	struct sim_cpu *cpu = sim->__cpu;
+	struct checkpoint locations, out;
+	char *buffer = NULL;
+	size_t size = 0;
+	FILE *stream, *file;
+
+	__account_inversion();
+	header = (struct checkpoint_header) {
+		.version = CHECKPOINT_VERSION,
+		.tick = ticks,
+		.nr_cpus = NR_CPUS,
+		.nr_resources = NR_RESOURCES,
+		.nr_records = sim->__metrics.nr_records,
+		.busy_ticks = sim->__metrics.busy_ticks,
+		.idle_ticks = sim->__metrics.idle_ticks,
+		.nr_context_switches = sim->__metrics.nr_context_switches,
+		.inversion_ticks = sim->__metrics.inversion_ticks,
+	};
+
+	if (sim->sched->checkpoint == NULL && sim->__cpus[0].__sched_data) {
+		fprintf(stderr, "%s cannot be checkpointed\n", sim->sched->name);
+		__checkpoint_every = 0;
+		return;
+	}
+
+	/* Locate the processes first, which builds up the process table */
+	stream = open_memstream(&buffer, &size);
+	assert(stream && "Out of memory");
+	checkpoint_init(&locations, stream);
+	__write_locations(&locations);
+	fclose(stream);
+	sim->__cpu = cpu;
+
+	snprintf(filename, sizeof(filename), "%s/%c.%u", __checkpoint_dir,
+			__option_of(sim->sched), ticks);
+	file = fopen(filename, "wb");
+	if (!file) {
+		fprintf(stderr, "Cannot open checkpoint %s\n", filename);
+		goto out;
+	}
+
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+	strncpy(header.scheduler, sim->sched->name, sizeof(header.scheduler) - 1);
+	header.nr_processes = locations.nr_processes;
+
+	checkpoint_init(&out, file);
+	checkpoint_write(&out, &header, sizeof(header));
+	for (unsigned int i = 0; i < locations.nr_processes; i++) {
+		__write_process(&out, locations.processes[i]);
+	}
+	if (sim->__metrics.nr_records) {
+		checkpoint_write(&out, sim->__metrics.records,
+				sizeof(*sim->__metrics.records) * sim->__metrics.nr_records);
+	}
+	checkpoint_write(&out, buffer, size);
+
+	if (fclose(file) || out.failed || locations.failed)
+		fprintf(stderr, "Cannot write checkpoint %s\n", filename);
+
+out:
+	checkpoint_destroy(&locations);
+	free(buffer);
+}
+
+static struct process *__read_process(struct checkpoint *c)
+{
+	struct checkpoint_process cp;
+	struct process *p;
+
+	checkpoint_read(c, &cp, sizeof(cp));
+	if (c->failed || cp.cpu >= NR_CPUS ||
+			(cp.blocked_on != CHECKPOINT_NONE && cp.blocked_on >= NR_RESOURCES) ||
+			(cp.waiting_for != CHECKPOINT_NONE && cp.waiting_for >= NR_RESOURCES))
+		return NULL;
+
+	p = __alloc_process();
+
+	p->pid = cp.pid;
+	p->status = cp.status;
+	p->age = cp.age;
+	p->lifespan = cp.lifespan;
+	p->prio = cp.prio;
+	p->prio_orig = cp.prio_orig;
+	p->__cold->__starts_at = cp.starts_at;
+	p->__cpu = cp.cpu;
+	p->blocked_on = cp.blocked_on != CHECKPOINT_NONE ? resources + cp.blocked_on : NULL;
+	p->__cold->__first_run_at = cp.first_run_at;
+	p->__cold->__blocked_at = cp.blocked_at;
+	p->__cold->__blocked_ticks = cp.blocked_ticks;
+	p->__cold->__nr_preemptions = cp.nr_preemptions;
+	p->__cold->__waiting_for = cp.waiting_for;
+	memcpy(p->__queue_state, cp.queue_state, sizeof(p->__queue_state));
+
+	checkpoint_add_process(c, p);
+
+	if (!__read_schedules(c, &p->__cold->__resources_to_acquire, cp.nr_to_acquire, false, p->age) ||
+			!__read_schedules(c, &p->__cold->__resources_holding, cp.nr_holding, true, p->age))
+		return NULL;
+
+	for (unsigned int i = 0; i < cp.nr_held; i++) {
+		unsigned int resource_id = checkpoint_read_u32(c);
+
+		if (c->failed || resource_id >= NR_RESOURCES)
+			return NULL;
+		list_add_tail(&resources[resource_id].held, &p->holding);
+	}
+	return p;
+}
+
+/**
+ * Rebuild the count of the waiters of @r restored
+ */
+static void __count_waiters(struct resource *r)
+{
+	struct process *p;
+	int level;
+
+	list_for_each_entry(p, &r->waitqueue, list) {
+		__add_waiter(r, p);
+	}
+	if (!r->prio_waitqueue)
+		return;
+	prioq_for_each_entry(p, r->prio_waitqueue, level) {
+		__add_waiter(r, p);
+	}
+}
+
+static bool __read_locations(struct checkpoint *c)
+{
+	unsigned int nr_active;
+
+	for (unsigned int i = 0; i < NR_CPUS; i++) {
+		sim->__cpu = sim->__cpus + i;
+
+		current = checkpoint_read_process(c);
+		if (!__read_process_list(c, &readyqueue))
+			return false;
+		sim->__cpu->__nr_processes = checkpoint_read_u32(c);
+		if (sim->sched->restore && sim->sched->restore(c))
+			return false;
+	}
+
+	nr_active = checkpoint_read_u32(c);
+	for (unsigned int i = 0; i < nr_active && !c->failed; i++) {
+		unsigned int resource_id = checkpoint_read_u32(c);
+		struct resource *r = resources + resource_id;
+
+		if (c->failed || resource_id >= NR_RESOURCES)
+			return false;
+
+		r->owner = checkpoint_read_process(c);
+		if (!__read_process_list(c, &r->waitqueue) ||
+				!prioq_restore(resource_prio_waitqueue(r), c))
+			return false;
+		__put_prio_waitqueue(r);
+		__update_active_resource(resource_id);
+		__count_waiters(r);
+	}
+
+	return __read_process_list(c, &sim->__forkqueue);
+}
+
+/**
+ * Rebuild the simulation @sim points to from the checkpoint in @file, after
+ * the scheduler has been initialized
+ */
+static bool __restore_checkpoint(FILE *file)
+{
+	struct checkpoint_header header;
+	struct checkpoint c;
+	bool result = false;
+
+	checkpoint_init(&c, file);
+	checkpoint_read(&c, &header, sizeof(header));
+	if (c.failed || memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) ||
+			header.version != CHECKPOINT_VERSION) {
+		fprintf(stderr, "Not a checkpoint of this version\n");
+		return false;
+	}
+	if (header.nr_cpus != NR_CPUS ||
+			strncmp(header.scheduler, sim->sched->name, sizeof(header.scheduler))) {
+		fprintf(stderr, "The checkpoint is of %.*s on %u CPU(s)\n",
+				(int)sizeof(header.scheduler), header.scheduler, header.nr_cpus);
+		return false;
+	}
+	if (header.nr_resources > MAX_RESOURCES) {
+		fprintf(stderr, "Corrupted checkpoint\n");
+		return false;
+	}
+
+	ticks = header.tick;
+	sim_setup_resources(sim, header.nr_resources);
+	sim->__metrics.busy_ticks = header.busy_ticks;
+	sim->__metrics.idle_ticks = header.idle_ticks;
+	sim->__metrics.nr_context_switches = header.nr_context_switches;
+	sim->__metrics.inversion_ticks = header.inversion_ticks;
+	sim->__inverted_since = ticks;
+
+	for (unsigned int i = 0; i < header.nr_processes; i++) {
+		if (!__read_process(&c))
+			goto out;
+	}
+	for (unsigned int i = 0; i < header.nr_records && !c.failed; i++) {
+		struct metrics_record record;
+
+		checkpoint_read(&c, &record, sizeof(record));
+		metrics_add(&sim->__metrics, &record);
+	}
+	result = !c.failed && __read_locations(&c);
+
+out:
+	if (!result)
+		fprintf(stderr, "Corrupted checkpoint\n");
+	checkpoint_destroy(&c);
+	sim->__cpu = sim->__cpus;
+	return result;
+}
+
+/**
+ * Open the latest checkpoint of @s at or before @tick in @__checkpoint_dir
+ */
+static FILE *__open_checkpoint(const struct scheduler *s, unsigned int tick)
+{
+	char filename[MAX_COMMAND_LEN];
+	DIR *dir = opendir(__checkpoint_dir);
+	struct dirent *entry;
+	bool found = false;
+	unsigned int nearest = 0;
+	FILE *file;
+
+	if (!dir) {
+		fprintf(stderr, "Cannot open checkpoint directory %s\n", __checkpoint_dir);
+		return NULL;
+	}
+	while ((entry = readdir(dir))) {
+		unsigned int at;
+		char option;
+		int len;
+
+		if (sscanf(entry->d_name, "%c.%u%n", &option, &at, &len) != 2 ||
+				entry->d_name[len] || option != __option_of(s))
+			continue;
+		if (at <= tick && (!found || at > nearest)) {
+			nearest = at;
+			found = true;
+		}
+	}
+	closedir(dir);
+
+	if (!found) {
+		fprintf(stderr, "No checkpoint of %s at or before tick %u in %s\n", s->name, tick,
+				__checkpoint_dir);
+		return NULL;
+	}
+
+	snprintf(filename, sizeof(filename), "%s/%c.%u", __checkpoint_dir, __option_of(s), nearest);
+	file = fopen(filename, "rb");
+	if (!file) {
+		fprintf(stderr, "Cannot open checkpoint %s\n", filename);
+		return NULL;
+	}
+	if (!quiet)
+		printf("Resuming from %s\n\n", filename);
+	return file;
+}
+
+/**
+ * Fill in the snapshot of the telemetry. The resources walked are only
+ * those in use
+ */
+static void __fill_telemetry(void)
+{
+	struct telemetry *t = &sim->__telemetry;
+	unsigned int nr_processes = 0, nr_running = 0, nr_blocked = 0;
+
+	t->hottest = UINT_MAX;
+	t->nr_hottest_waiters = 0;
+
+	for (unsigned int i = 0; i < NR_CPUS; i++) {
+		struct sim_cpu *cpu = sim->__cpus + i;
+
+		nr_processes += cpu->__nr_processes;
+		if (cpu->__current && cpu->__current->status == PROCESS_RUNNING)
+			nr_running++;
+	}
+
+	for (unsigned int w = 0; w < __nr_resource_words(NR_RESOURCES); w++) {
+		for (unsigned long long active = sim->__active_resources[w]; active;
+				active &= active - 1) {
+			unsigned int resource_id = w * 64 + __builtin_ctzll(active);
+			unsigned int nr = __nr_waiters(resource_id);
+
+			nr_blocked += nr;
+			if (nr > t->nr_hottest_waiters) {
+				t->hottest = resource_id;
+				t->nr_hottest_waiters = nr;
+			}
+		}
+	}
+
+	t->tick = ticks;
+	t->nr_processes = nr_processes;
+	t->nr_running = nr_running;
+	t->nr_blocked = nr_blocked;
+	t->nr_ready = nr_processes > nr_running + nr_blocked ?
+			nr_processes - nr_running - nr_blocked : 0;
+}
+
+static void __publish_telemetry(void)
+{
+	__fill_telemetry();
+	telemetry_published(&sim->__telemetry);
+}
+
+/***********************************************************************
+ * The main loop for the scheduler simulation. Return false if the workload
+ * being streamed turns out to be broken, or if the processes deadlock
+ */
+static __tick_inline bool __do_simulation(const struct scheduler *s)
+{
+	assert(s->schedule && "scheduler.schedule() not implemented");
+
+	while (true) {
+		/* Hand a snapshot over if the telemetry thread has asked for one */
+		if (telemetry_requested(&sim->__telemetry))
+			__publish_telemetry();
+
+		/* Save the state at the beginning of every @__checkpoint_every ticks */
+		if (__checkpoint_every && ticks >= sim->__next_checkpoint) {
+			__write_checkpoint();
+			sim->__next_checkpoint = (ticks / __checkpoint_every + 1) * __checkpoint_every;
+		}
+
+		/* Skip the ticks in which @current would run without any event */
+		if (fastforward && s->nonpreemptive &&
+				current && current->status == PROCESS_RUNNING) {
+			__fastforward_current();
+		}
+
+		/* Read ahead the processes to fork soon, after fast-forwarding */
+		if (sim->__stream && !__stream_workload())
+			return false;
+
+		/* Fork processes on schedule */
+		__fork_on_schedule(s);
+
+		/* Run each CPU in turn for this tick */
+		for (unsigned int i = 0; i < NR_CPUS; i++) {
+			sim->__cpu = sim->__cpus + i;
+			__run_cpu(s);
+		}
+		if (stop_on_deadlock && sim->__deadlocked)
+			return false;
+
+		/* Quit simulation if no CPU has anything to run nor pending process exists */
+		if (__all_cpus_idle() && list_empty(&sim->__forkqueue)) {
+			break;
+		}
+
+		/* Idle the CPUs without a process temporarily */
+		for (unsigned int i = 0; i < NR_CPUS; i++) {
+			sim->__cpu = sim->__cpus + i;
+			if (current)
+				continue;
+
+			__print_event(0, "idle");
+			__trace_event(TRACE_IDLE, NULL, 0);
+			sim->__metrics.idle_ticks++;
+
+			if (fastforward && list_empty(&readyqueue)) {
+				__fastforward_idle();
+			}
+		}
+
+		/* Increase the tick counter */
+		ticks++;
+	}
+	return true;
+}
+
+#ifdef CONFIG_SPECIALIZE
+#define SPECIALIZED_SIMULATION(name) \
+	static bool __do_simulation_##name(void) \
+	{ \
+		return __do_simulation(&name##_scheduler); \
+	}
+
+SPECIALIZED_SIMULATION(fcfs)
+SPECIALIZED_SIMULATION(sjf)
+SPECIALIZED_SIMULATION(stcf)
+SPECIALIZED_SIMULATION(rr)
+SPECIALIZED_SIMULATION(prio)
+SPECIALIZED_SIMULATION(pa)
+SPECIALIZED_SIMULATION(pcp)
+SPECIALIZED_SIMULATION(pip)
+SPECIALIZED_SIMULATION(stride)
+SPECIALIZED_SIMULATION(cfs)
+SPECIALIZED_SIMULATION(mlfq)
+
+/**
+ * The main loop specialized for each scheduler, in the order of __schedulers
+ */
+static bool (*const __specialized[NR_SCHEDULERS])(void) = {
+	__do_simulation_fcfs, __do_simulation_sjf, __do_simulation_stcf, __do_simulation_rr,
+	__do_simulation_prio, __do_simulation_pa, __do_simulation_pcp, __do_simulation_pip,
+	__do_simulation_stride, __do_simulation_cfs, __do_simulation_mlfq,
+};
+#endif
+
+void sim_init(struct sim_context *ctx, const struct scheduler *sched, unsigned int nr_cpus)
+{
+	ctx->__cpus = calloc(nr_cpus, sizeof(struct sim_cpu));
+	assert(ctx->__cpus && "Out of memory");
+	ctx->__nr_cpus = nr_cpus;
+	ctx->__cpu = ctx->__cpus;
+
+	for (unsigned int i = 0; i < nr_cpus; i++) {
+		ctx->__cpus[i].__current = NULL;
+		INIT_LIST_HEAD(&ctx->__cpus[i].__readyqueue);
+		ctx->__cpus[i].__sched_data = NULL;
+		ctx->__cpus[i].__nr_processes = 0;
+	}
+
+	ctx->__ticks = 0;
+
+	ctx->__resources = NULL;
+	ctx->__nr_resources = 0;
+	ctx->__nr_resources_used = 0;
+	ctx->__active_resources = NULL;
+
+	ctx->sched = sched;
+
+	INIT_LIST_HEAD(&ctx->__forkqueue);
+	ctx->__stream = NULL;
+
+	pool_init(&ctx->__process_pool, sizeof(struct process), CACHELINE_SIZE,
+			POOL_NR_OBJECTS_PER_SLAB);
+	pool_init(&ctx->__process_cold_pool, sizeof(struct process_cold), 0,
+			POOL_NR_OBJECTS_PER_SLAB);
+	pool_init(&ctx->__resource_schedule_pool, sizeof(struct resource_schedule), 0,
+			POOL_NR_OBJECTS_PER_SLAB);
+	pool_init(&ctx->__resource_waiters_pool, sizeof(struct resource_waiters), 0,
+			POOL_NR_WAITED_PER_SLAB);
+	pool_init(&ctx->__prioq_pool, sizeof(struct prioq), 0, POOL_NR_WAITED_PER_SLAB);
+
+	ctx->__events = malloc(EVENT_BUFFER_SIZE);
+	assert(ctx->__events && "Out of memory");
+	ctx->__nr_events_bytes = 0;
+	ctx->__events_stream = NULL;
+	ctx->__discard_events = false;
+	ctx->__script = NULL;
+
+	ctx->__trace = NULL;
+
+	ctx->__resume = NULL;
+	ctx->__next_checkpoint = 0;
+
+	ctx->__nr_inverted = 0;
+	ctx->__inverted_since = 0;
+	ctx->__deadlocked = NULL;
+	ctx->__deadlocked_at = 0;
+
+	metrics_init(&ctx->__metrics);
+#ifdef CONFIG_PROFILE
+	profile_init(&ctx->__profile);
+#endif
+}
+
+static struct resource *__alloc_resource_table(unsigned int nr_resources)
+{
+	void *table = NULL;
+
+	if (!nr_resources)
+		nr_resources = 1;
+
+	/* A resource fills a cache line exactly. Keep each of them in one */
+	if (posix_memalign(&table, CACHELINE_SIZE, sizeof(struct resource) * nr_resources))
+		table = NULL;
+	assert(table && "Out of memory");
+	return table;
+}
+
+static void __init_resource(struct resource *r)
+{
+	r->owner = NULL;
+	INIT_LIST_HEAD(&r->waitqueue);
+	r->prio_waitqueue = NULL;
+	INIT_LIST_HEAD(&r->held);
+	r->__waiters = NULL;
+	r->__nr_inverted = 0;
+}
+
+void sim_setup_resources(struct sim_context *ctx, unsigned int nr_resources)
+{
+	unsigned int nr_words = __nr_resource_words(nr_resources);
+
+	ctx->__resources = __alloc_resource_table(nr_resources);
+	ctx->__active_resources = calloc(nr_words ? nr_words : 1,
+			sizeof(unsigned long long));
+	assert(ctx->__active_resources && "Out of memory");
+	ctx->__nr_resources = nr_resources;
+
+	for (unsigned int i = 0; i < nr_resources; i++) {
+		__init_resource(ctx->__resources + i);
+	}
+}
+
+/**
+ * Point @pos, which may be in the resource table at @from, to the same place
+ * in the table at @to
+ */
+static inline void *__relocate(void *pos, struct resource *from, struct resource *to,
+		unsigned int nr_resources)
+{
+	char *p = pos;
+
+	if (p < (char *)from || p >= (char *)(from + nr_resources))
+		return pos;
+	return (char *)to + (p - (char *)from);
+}
+
+static void __relink(struct list_head *head, struct resource *from, struct resource *to,
+		unsigned int nr_resources)
+{
+	head->next = __relocate(head->next, from, to, nr_resources);
+	head->prev = __relocate(head->prev, from, to, nr_resources);
+}
+
+/**
+ * Grow the resource table of @ctx to @nr_resources entries while the
+ * simulation is going on. The list heads in the table are linked with the
+ * processes and with each other, and the processes blocked under PIP point
+ * to the resource they wait for, so they are all moved over to the new table.
+ */
+void sim_grow_resources(struct sim_context *ctx, unsigned int nr_resources)
+{
+	struct resource *from = ctx->__resources;
+	struct resource *to = __alloc_resource_table(nr_resources);
+	unsigned int nr_from = ctx->__nr_resources;
+	unsigned int nr_words = __nr_resource_words(nr_resources);
+	unsigned int nr_words_from = __nr_resource_words(nr_from);
+	unsigned long long *active;
+
+	memcpy(to, from, sizeof(*from) * nr_from);
+	for (unsigned int i = 0; i < nr_from; i++) {
+		__relink(&to[i].waitqueue, from, to, nr_from);
+		__relink(&to[i].held, from, to, nr_from);
+	}
+	for (unsigned int i = 0; i < nr_from; i++) {
+		struct resource *r = to + i;
+		struct process *p;
+		int level;
+
+		r->waitqueue.next->prev = r->waitqueue.prev->next = &r->waitqueue;
+		r->held.next->prev = r->held.prev->next = &r->held;
+
+		list_for_each_entry(p, &r->waitqueue, list) {
+			p->blocked_on = __relocate(p->blocked_on, from, to, nr_from);
+		}
+		if (r->prio_waitqueue) {
+			prioq_for_each_entry(p, r->prio_waitqueue, level) {
+				p->blocked_on = __relocate(p->blocked_on, from, to, nr_from);
+			}
+		}
+	}
+	for (unsigned int i = nr_from; i < nr_resources; i++) {
+		__init_resource(to + i);
+	}
+	free(from);
+
+	active = realloc(ctx->__active_resources, sizeof(*active) * (nr_words ? nr_words : 1));
+	assert(active && "Out of memory");
+	memset(active + nr_words_from, 0x00, sizeof(*active) * (nr_words - nr_words_from));
+
+	ctx->__resources = to;
+	ctx->__active_resources = active;
+	ctx->__nr_resources = nr_resources;
+}
+
+void sim_destroy(struct sim_context *ctx)
+{
+	metrics_destroy(&ctx->__metrics);
+
+	free(ctx->__cpus);
+	ctx->__cpus = ctx->__cpu = NULL;
+
+	free(ctx->__resources);
+	ctx->__resources = NULL;
+	free(ctx->__active_resources);
+	ctx->__active_resources = NULL;
+
+	pool_destroy(&ctx->__resource_schedule_pool);
+	pool_destroy(&ctx->__process_pool);
+	pool_destroy(&ctx->__process_cold_pool);
+	pool_destroy(&ctx->__resource_waiters_pool);
+	pool_destroy(&ctx->__prioq_pool);
+
+	free(ctx->__events);
+	ctx->__events = NULL;
+}
+
+/**
+ * Print the metrics of the simulation that @sim points to
+ */
+static void __print_metrics(void)
+{
+	struct metrics_summary summary;
+
+	metrics_summarize(&sim->__metrics, ticks, NR_CPUS, &summary);
+	metrics_print(stdout, sim->sched->name, &sim->__metrics, &summary);
+}
+
+/**
+ * Print the costs of the scheduler callbacks in the simulation @sim points to
+ */
+static void __print_profile(void)
+{
+#ifdef CONFIG_PROFILE
+	profile_print(stdout, sim->sched->name, &sim->__profile);
+#endif
+}
+
+/**
+ * Run the simulation that @sim points to
+ */
+static int __run_simulation(void)
+{
+	bool result;
+
+	for (unsigned int i = 0; i < NR_CPUS; i++) {
+		sim->__cpu = sim->__cpus + i;
+		if (sim->sched->initialize && sim->sched->initialize()) {
+			return false;
+		}
+	}
+
+	if (sim->__resume) {
+		if (!__restore_checkpoint(sim->__resume))
+			return false;
+		if (__checkpoint_every)
+			sim->__next_checkpoint = (ticks / __checkpoint_every + 1) * __checkpoint_every;
+	}
+
+	telemetry_register(&sim->__telemetry, __option_of(sim->sched));
+#ifdef CONFIG_SPECIALIZE
+	result = __specialized[__index_of(sim->sched)]();
+#else
+	result = __do_simulation(sim->sched);
+#endif
+	__account_inversion();
+	if (telemetry_enabled())
+		__fill_telemetry();
+	telemetry_unregister(&sim->__telemetry);
+	__flush_events();
+	__report_deadlock();
+
+	for (unsigned int i = 0; i < NR_CPUS; i++) {
+		sim->__cpu = sim->__cpus + i;
+		if (sim->sched->finalize) {
+			sim->sched->finalize();
+		}
+	}
+	sim->__cpu = sim->__cpus;
+	return result;
+}
+
+/**
+ * The processes as loaded from the script, from which each run takes a fresh
+ * copy when running multiple schedulers in one go. It is not modified while
+ * the runs are going on.
+ */
+static LIST_HEAD(__pristine_forkqueue);
+
+static void __clone_forkqueue(void)
+{
+	struct process *p;
+	struct resource_schedule *rs;
+
+	list_for_each_entry(p, &__pristine_forkqueue, list) {
+		struct process *clone = __alloc_process();
+		struct process_cold *cold = clone->__cold;
+
+		*clone = *p;
+		*cold = *p->__cold;
+		clone->__cold = cold;
+		INIT_LIST_HEAD(&clone->list);
+		INIT_LIST_HEAD(&clone->holding);
+		INIT_LIST_HEAD(&cold->__resources_to_acquire);
+		INIT_LIST_HEAD(&cold->__resources_holding);
+
+		list_for_each_entry(rs, &p->__cold->__resources_to_acquire, list) {
+			struct resource_schedule *rs_clone = pool_alloc(&sim->__resource_schedule_pool);
+
+			*rs_clone = *rs;
+			list_add_tail(&rs_clone->list, &clone->__cold->__resources_to_acquire);
+		}
+		list_add_tail(&clone->list, &sim->__forkqueue);
+	}
+}
+
+struct sim_run {
+	struct sim_context ctx;
+	pthread_t thread;
+	int result;
+};
+
+static void *__run_thread(void *arg)
+{
+	struct sim_run *run = arg;
+
+	sim = &run->ctx;
+
+	__clone_forkqueue();
+	run->result = __run_simulation();
+
+	return NULL;
+}
+
+/**
+ * Run each of the selected schedulers (or all of them if none is selected)
+ * over a fresh copy of the loaded processes, each on its own thread.
+ * The events of each run are written to @prefix.<option of the scheduler>.
+ */
+static void __select_all_if_none(void)
+{
+	if (__nr_selected == 0) {
+		memcpy(__selected, __schedulers, sizeof(__schedulers));
+		__nr_selected = NR_SCHEDULERS;
+	}
+}
+
+static int __run_schedulers(char *const prefix)
+{
+	struct sim_run *runs;
+	unsigned int nr_started = 0;
+	int result = true;
+
+	__select_all_if_none();
+
+	list_splice_init(&sim->__forkqueue, &__pristine_forkqueue);
+
+	runs = calloc(__nr_selected, sizeof(*runs));
+	assert(runs && "Out of memory");
+
+	for (unsigned int i = 0; i < __nr_selected; i++) {
+		struct sim_run *run = runs + i;
+		char filename[MAX_COMMAND_LEN];
 
-static struct scheduler *sched = &fcfs_scheduler;
+		snprintf(filename, sizeof(filename), "%s.%c", prefix, __option_of(__selected[i]));
 
-void dump_status(void)
-{
-	struct process *p;
+		sim_init(&run->ctx, __selected[i], nr_cpus);
+		sim_setup_resources(&run->ctx, sim->__nr_resources);
+		run->ctx.__events_stream = fopen(filename, "w");
+		if (!run->ctx.__events_stream) {
+			fprintf(stderr, "Cannot open %s\n", filename);
+			sim_destroy(&run->ctx);
+			result = false;
+			break;
+		}
 
-	printf("***** CURRENT *********\n");
-	if (current) {
-		printf("%2d (%s): %d + %d/%d at %d\n", current->pid,
-		       __process_status_sz[current->status], current->__starts_at, current->age,
-		       current->lifespan, current->prio);
-	}
+		if (!quiet)
+			printf("Simulating %s scheduler into %s\n", __selected[i]->name, filename);
 
-	printf("***** READY QUEUE *****\n");
-	list_for_each_entry(p, &readyqueue, list) {
-		printf("%2d (%s): %d + %d/%d at %d\n", p->pid, __process_status_sz[p->status],
-		       p->__starts_at, p->age, p->lifespan, p->prio);
+		if (pthread_create(&run->thread, NULL, __run_thread, run)) {
+			fprintf(stderr, "Cannot start a thread for %s\n", filename);
+			fclose(run->ctx.__events_stream);
+			sim_destroy(&run->ctx);
+			result = false;
+			break;
+		}
+		nr_started++;
 	}
 
-	printf("***** RESOURCES *******\n");
-	for (int i = 0; i < NR_RESOURCES; i++) {
-		struct resource *r = resources + i;
+	for (unsigned int i = 0; i < nr_started; i++) {
+		struct sim_run *run = runs + i;
 
-		if (r->owner || !list_empty(&r->waitqueue)) {
-			printf("%2d: owned by ", i);
-			if (r->owner) {
-				printf("%d\n", r->owner->pid);
-			} else {
-				printf("no one\n");
-			}
+		pthread_join(run->thread, NULL);
+		if (!run->result)
+			result = false;
 
-			list_for_each_entry(p, &r->waitqueue, list) {
-				printf("    %d is waiting\n", p->pid);
-			}
+		sim = &run->ctx;
+		if (print_metrics) {
+			__print_metrics();
 		}
+		__print_profile();
+
+		fclose(run->ctx.__events_stream);
+		sim_destroy(&run->ctx);
 	}
-	printf("\n\n");
 
-	return;
+	free(runs);
+	return result;
 }
 
-#define __print_event(pid, string, args...)   \
-	do {                                      \
-		fprintf(stderr, "%3d: ", ticks);      \
-		for (unsigned int i = 0; i < pid; i++) {       \
-			fprintf(stderr, "    ");          \
-		}                                     \
-		fprintf(stderr, string "\n", ##args); \
-	} while (0);
+/***********************************************************************
+ * Batch mode
+ *
+ * Run every selected scheduler over every script on a pool of threads, where
+ * each (script, scheduler) pair is a job simulated in its own context. The
+ * events are discarded unless a log directory is given, in which case those
+ * of each job go to <dir>/<script name>.<option of the scheduler>.
+ */
+struct batch_job {
+	const char *script;
+	const struct scheduler *sched;
+
+	bool done;
+	unsigned int nr_processes;
+	unsigned int nr_ticks;
+	struct metrics_summary summary;
+	unsigned long long nr_context_switches;
+	unsigned long long inversion_ticks;
+	double msecs;
+	double simulation_msecs;	/* Out of @msecs, spent in __run_simulation() */
+};
+
+static struct batch_job *__batch_jobs;
+static unsigned int __nr_batch_jobs;
+static unsigned int __next_batch_job = 0;
+static pthread_mutex_t __batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static const char *__batch_logdir = NULL;
 
-static inline bool strmatch(char *const str, const char *expect)
+static inline double __msecs_between(const struct timespec *begin, const struct timespec *end)
 {
-	return (strlen(str) == strlen(expect)) && (strncmp(str, expect, strlen(expect)) == 0);
+	return (end->tv_sec - begin->tv_sec) * 1e3 + (end->tv_nsec - begin->tv_nsec) / 1e6;
 }
 
-static void __briefing_schedule(struct process *p)
+static bool __run_batch_job(struct batch_job *job)
 {
-	struct resource_schedule *rs;
+	struct sim_context ctx;
+	struct timespec begin, simulated, end;
+	struct process *p;
+	bool result = false;
 
-	if (quiet)
-		return;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
 
-	printf("- Process %d: Forked at tick %d and run for %d tick%s with initial priority %d\n",
-	       p->pid, p->__starts_at, p->lifespan, p->lifespan >= 2 ? "s" : "", p->prio);
+	sim_init(&ctx, job->sched, nr_cpus);
+	ctx.__script = job->script;
+	sim = &ctx;
 
-	list_for_each_entry(rs, &p->__resources_to_acquire, list) {
-		printf("    Acquire resource [%d] at %d for %d\n", rs->resource_id, rs->at,
-		       rs->duration);
+	if (__batch_logdir) {
+		char filename[MAX_COMMAND_LEN];
+		const char *name = strrchr(job->script, '/');
+
+		snprintf(filename, sizeof(filename), "%s/%s.%c", __batch_logdir,
+				name ? name + 1 : job->script, __option_of(job->sched));
+		ctx.__events_stream = fopen(filename, "w");
+		if (!ctx.__events_stream) {
+			fprintf(stderr, "Cannot open %s\n", filename);
+			goto out;
+		}
+	} else {
+		ctx.__discard_events = true;
 	}
-}
 
-static int __load_script(char *const filename)
-{
-	char line[MAX_COMMAND_LEN];
-	struct process *p = NULL;
+	if (!__load_script((char *)job->script))
+		goto out;
 
-	FILE *file = fopen(filename, "r");
-	while (fgets(line, sizeof(line), file)) {
-		char *tokens[MAX_NR_TOKENS] = { NULL };
-		int nr_tokens = parse_command(line, tokens);
+	list_for_each_entry(p, &ctx.__forkqueue, list) {
+		job->nr_processes++;
+	}
+	__sort_forkqueue();
+	sim_setup_resources(&ctx, __resource_limit ? __resource_limit : ctx.__nr_resources_used);
+
+	clock_gettime(CLOCK_MONOTONIC, &simulated);
+	if (!__run_simulation())
+		goto out;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	job->simulation_msecs = __msecs_between(&simulated, &end);
+
+	job->nr_ticks = ticks;
+	metrics_summarize(&ctx.__metrics, ticks, NR_CPUS, &job->summary);
+	job->nr_context_switches = ctx.__metrics.nr_context_switches;
+	job->inversion_ticks = ctx.__metrics.inversion_ticks;
+	result = true;
+
+out:
+	if (ctx.__events_stream)
+		fclose(ctx.__events_stream);
+	sim_destroy(&ctx);
+	sim = NULL;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	job->msecs = __msecs_between(&begin, &end);
+	return result;
+}
 
-		if (nr_tokens == 0)
-			continue;
+static void *__batch_worker(void *arg)
+{
+	while (true) {
+		struct batch_job *job;
 
-		if (strmatch(tokens[0], "process")) {
-			assert(nr_tokens == 2);
-			/* Start processor description */
-			p = malloc(sizeof(*p));
-			memset(p, 0x00, sizeof(*p));
+		pthread_mutex_lock(&__batch_lock);
+		job = __next_batch_job < __nr_batch_jobs ? __batch_jobs + __next_batch_job++ : NULL;
+		pthread_mutex_unlock(&__batch_lock);
 
-			p->pid = atoi(tokens[1]);
+		if (!job)
+			break;
+		job->done = __run_batch_job(job);
+	}
+	return NULL;
+}
 
-			INIT_LIST_HEAD(&p->list);
-			INIT_LIST_HEAD(&p->__resources_to_acquire);
-			INIT_LIST_HEAD(&p->__resources_holding);
+static int __run_batch(char *const scripts[], unsigned int nr_scripts, unsigned int nr_workers)
+{
+	pthread_t *workers;
+	unsigned int nr_started = 0;
+	unsigned int nr_failed = 0;
+	struct rusage usage;
 
-			continue;
-		} else if (strmatch(tokens[0], "end")) {
-			/* End of process description */
-			assert(p);
+	__select_all_if_none();
 
-			list_add_tail(&p->list, &__forkqueue);
+	__nr_batch_jobs = nr_scripts * __nr_selected;
+	__batch_jobs = calloc(__nr_batch_jobs, sizeof(*__batch_jobs));
+	assert(__batch_jobs && "Out of memory");
 
-			__briefing_schedule(p);
-			p = NULL;
+	for (unsigned int i = 0; i < nr_scripts; i++) {
+		for (unsigned int j = 0; j < __nr_selected; j++) {
+			struct batch_job *job = __batch_jobs + i * __nr_selected + j;
 
-			continue;
+			job->script = scripts[i];
+			job->sched = __selected[j];
 		}
+	}
 
-		if (strmatch(tokens[0], "lifespan")) {
-			assert(nr_tokens == 2);
-			p->lifespan = atoi(tokens[1]);
-		} else if (strmatch(tokens[0], "prio")) {
-			assert(nr_tokens == 2);
-			p->prio = p->prio_orig = atoi(tokens[1]);
-		} else if (strmatch(tokens[0], "start")) {
-			assert(nr_tokens == 2);
-			p->__starts_at = atoi(tokens[1]);
-		} else if (strmatch(tokens[0], "acquire")) {
-			struct resource_schedule *rs;
-			assert(nr_tokens == 4);
-
-			rs = malloc(sizeof(*rs));
-
-			*rs = (struct resource_schedule) {
-				.resource_id = atoi(tokens[1]),
-				.at = atoi(tokens[2]),
-				.duration = atoi(tokens[3]),
-			};
+	if (nr_workers > __nr_batch_jobs)
+		nr_workers = __nr_batch_jobs;
 
-			list_add_tail(&rs->list, &p->__resources_to_acquire);
-		} else {
-			fprintf(stderr, "Unknown property %s\n", tokens[0]);
-			return false;
+	workers = calloc(nr_workers, sizeof(*workers));
+	assert(workers && "Out of memory");
+
+	for (unsigned int i = 0; i < nr_workers; i++) {
+		if (pthread_create(workers + i, NULL, __batch_worker, NULL)) {
+			fprintf(stderr, "Cannot start a batch worker\n");
+			break;
 		}
+		nr_started++;
+	}
+	if (nr_started == 0) {
+		/* Do the jobs on this thread then */
+		__batch_worker(NULL);
 	}
-	fclose(file);
-	if (!quiet)
-		printf("\n");
-	return true;
-}
 
-/**
- * Fork process on schedule
- */
-static int __fork_on_schedule()
-{
-	int nr_forked = 0;
-	struct process *p, *tmp;
-	list_for_each_entry_safe(p, tmp, &__forkqueue, list) {
-		if (p->__starts_at <= ticks) {
-			list_move_tail(&p->list, &readyqueue);
-			p->status = PROCESS_READY;
-			__print_event(p->pid, "N");
-			if (sched->forked)
-				sched->forked(p);
-			nr_forked++;
+	for (unsigned int i = 0; i < nr_started; i++) {
+		pthread_join(workers[i], NULL);
+	}
+	free(workers);
+
+	printf("%-32s %-31s %10s %10s %10s %10s %8s %10s %10s %10s %12s %8s\n", "Script", "Scheduler",
+			"Processes", "Ticks", "Turnaround", "Response", "Util(%)", "Switches", "Inversion",
+			"Time (ms)", "Ticks/s", "ns/tick");
+	for (unsigned int i = 0; i < __nr_batch_jobs; i++) {
+		struct batch_job *job = __batch_jobs + i;
+		double secs = job->simulation_msecs / 1e3;
+
+		if (!job->done) {
+			printf("%-32s %-31s %10s %10s %10s %10s %8s %10s %10s %10.2f %12s %8s\n", job->script,
+					job->sched->name, "-", "FAILED", "-", "-", "-", "-", "-", job->msecs, "-", "-");
+			nr_failed++;
+			continue;
 		}
+		printf("%-32s %-31s %10u %10u %10.2f %10.2f %8.2f %10llu %10llu %10.2f %12.0f %8.1f\n",
+				job->script, job->sched->name, job->nr_processes, job->nr_ticks,
+				job->summary.turnaround.avg, job->summary.response.avg,
+				job->summary.utilization, job->nr_context_switches, job->inversion_ticks,
+				job->msecs,
+				secs > 0 ? job->nr_ticks / secs : 0,
+				job->nr_ticks ? secs * 1e9 / job->nr_ticks : 0);
 	}
-	return nr_forked;
+	getrusage(RUSAGE_SELF, &usage);
+	printf("\n%u job%s, %u failed, peak RSS %ld KiB\n", __nr_batch_jobs,
+			__nr_batch_jobs == 1 ? "" : "s", nr_failed, usage.ru_maxrss);
+
+	free(__batch_jobs);
+	return nr_failed == 0;
 }
 
+/***********************************************************************
+ * Differential mode
+ *
+ * Run the script through the reference engine, which loads the script text
+ * and simulates every tick, and then through each of the engine variants
+ * below. The events of every run are kept in memory and compared line by line
+ * against those of the reference, reporting the first tick they diverge in.
+ * A variant that takes a shortcut the reference does not should be added
+ * here so that `make check` covers it.
+ */
+struct engine_variant {
+	const char *name;
+	bool fastforward;		/* Skip the uneventful ticks as -F does */
+	bool image;				/* Load the workload image converted from the script */
+	bool resume;			/* Resume halfway from a checkpoint of the reference */
+};
+
+static const struct engine_variant __reference_engine = {
+	.name = "reference",
+};
+
+static const struct engine_variant __engine_variants[] = {
+	{ .name = "fast-forward", .fastforward = true, },
+	{ .name = "workload image", .image = true, },
+	{ .name = "workload image + fast-forward", .fastforward = true, .image = true, },
+	{ .name = "checkpoint + resume", .resume = true, },
+};
+
+struct event_log {
+	char *events;
+	size_t size;
+};
+
 /**
- * Exit the process
+ * Simulate @scriptfile, or @imagefile for the variants loading the image,
+ * with @sched in the way @variant does, into @log
  */
-static void __exit_process(struct process *p)
+static bool __run_engine(const struct engine_variant *variant, const struct scheduler *sched,
+		char *const scriptfile, char *const imagefile, struct event_log *log)
 {
-	/* Make sure the process is not attached to some list head */
-	assert(list_empty(&p->list));
+	struct sim_context ctx;
+	bool result = false;
 
-	/* Make sure the process is not holding any resource */
-	assert(list_empty(&p->__resources_holding));
+	sim_init(&ctx, sched, 1);
+	sim = &ctx;
+	fastforward = variant->fastforward;
 
-	/* Make sure there is no pending resource to acquire */
-	assert(list_empty(&p->__resources_to_acquire));
+	ctx.__events_stream = open_memstream(&log->events, &log->size);
+	if (!ctx.__events_stream) {
+		fprintf(stderr, "Cannot keep the events in memory\n");
+		goto out;
+	}
 
-	if (sched->exiting)
-		sched->exiting(p);
+	if (!__load_script(variant->image ? imagefile : scriptfile))
+		goto out;
+	__sort_forkqueue();
+	sim_setup_resources(&ctx, __resource_limit ? __resource_limit : ctx.__nr_resources_used);
 
-	__print_event(p->pid, "X");
+	result = __run_simulation();
 
-	free(p);
+out:
+	if (ctx.__events_stream)
+		fclose(ctx.__events_stream);
+	sim_destroy(&ctx);
+	sim = NULL;
+	return result;
 }
 
 /**
- * Process resource acqutision
+ * Checkpoint the reference run of @scriptfile at @tick into a temporary
+ * directory, and resume from there into @log
  */
-static bool __run_current_acquire()
+static bool __run_resumed(const struct scheduler *sched, char *const scriptfile, unsigned int tick,
+		struct event_log *log)
 {
-	struct resource_schedule *rs, *tmp;
-
-	list_for_each_entry_safe(rs, tmp, &current->__resources_to_acquire, list) {
-		if (rs->at == current->age) {
-			assert(sched->acquire && "scheduler.acquire() not implemented");
+	char dirname[] = "/tmp/sched-checkpoint-XXXXXX";
+	struct event_log scratch = { NULL, 0 };
+	struct sim_context ctx;
+	struct dirent *entry;
+	bool result = false;
+	DIR *dir;
+
+	if (!mkdtemp(dirname)) {
+		fprintf(stderr, "Cannot create a temporary checkpoint directory\n");
+		return false;
+	}
+	__checkpoint_dir = dirname;
+
+	/* 0 would disable the checkpoints. Resuming from tick 0 is all the same */
+	__checkpoint_every = tick ? tick : 1;
+	result = __run_engine(&__reference_engine, sched, scriptfile, NULL, &scratch);
+	__checkpoint_every = 0;
+	free(scratch.events);
+	if (!result)
+		goto out;
+
+	sim_init(&ctx, sched, 1);
+	sim = &ctx;
+	fastforward = false;
+	result = false;
+
+	ctx.__events_stream = open_memstream(&log->events, &log->size);
+	if (!ctx.__events_stream) {
+		fprintf(stderr, "Cannot keep the events in memory\n");
+	} else if ((ctx.__resume = __open_checkpoint(sched, tick))) {
+		result = __run_simulation();
+		fclose(ctx.__resume);
+	}
 
-			/* Callback to acquire the resource */
-			if (!sched->acquire(rs->resource_id)) {
-				__print_event(current->pid, "=[%d]", rs->resource_id);
-				return false;
-			}
+	if (ctx.__events_stream)
+		fclose(ctx.__events_stream);
+	sim_destroy(&ctx);
+	sim = NULL;
 
-			list_move_tail(&rs->list, &current->__resources_holding);
+out:
+	dir = opendir(dirname);
+	while (dir && (entry = readdir(dir))) {
+		char filename[MAX_COMMAND_LEN];
 
-			__print_event(current->pid, "+[%d]", rs->resource_id);
-		}
+		if (entry->d_name[0] == '.')
+			continue;
+		snprintf(filename, sizeof(filename), "%s/%s", dirname, entry->d_name);
+		unlink(filename);
 	}
-
-	return true;
+	if (dir)
+		closedir(dir);
+	rmdir(dirname);
+	__checkpoint_dir = ".";
+	return result;
 }
 
 /**
- * Process resource release
+ * Length of the event line at @pos of @log, excluding the newline
  */
-static void __run_current_release()
+static size_t __line_length(const struct event_log *log, size_t pos)
 {
-	struct resource_schedule *rs, *tmp;
+	const char *end = memchr(log->events + pos, '\n', log->size - pos);
 
-	list_for_each_entry_safe(rs, tmp, &current->__resources_holding, list) {
-		if (--rs->duration != 0) {
-			continue;
-		}
-		assert(sched->release && "scheduler.release() not implemented");
+	return end ? (size_t)(end - (log->events + pos)) : log->size - pos;
+}
 
-		/* Callback the release() */
-		sched->release(rs->resource_id);
+/**
+ * Find the first line where @a and @b differ. Return false if they are the same
+ */
+static bool __diverge_at(const struct event_log *a, const struct event_log *b,
+		size_t *line_a, size_t *line_b, unsigned int *nr_lines)
+{
+	size_t pos_a = 0, pos_b = 0;
 
-		__print_event(current->pid, "-[%d]", rs->resource_id);
+	*nr_lines = 0;
+	while (pos_a < a->size || pos_b < b->size) {
+		size_t len_a = pos_a < a->size ? __line_length(a, pos_a) + 1 : 0;
+		size_t len_b = pos_b < b->size ? __line_length(b, pos_b) + 1 : 0;
 
-		list_del(&rs->list);
-		free(rs);
+		if (len_a != len_b || memcmp(a->events + pos_a, b->events + pos_b, len_a)) {
+			*line_a = pos_a;
+			*line_b = pos_b;
+			return true;
+		}
+		pos_a += len_a;
+		pos_b += len_b;
+		(*nr_lines)++;
 	}
+	return false;
 }
 
-/***********************************************************************
- * The main loop for the scheduler simulation
+/**
+ * The events of @log from the first one in @tick or later on
  */
-static void __do_simulation(void)
+static struct event_log __events_since(const struct event_log *log, unsigned int tick)
 {
-	assert(sched->schedule && "scheduler.schedule() not implemented");
+	size_t pos = 0;
 
-	while (true) {
-		struct process *prev;
+	while (pos < log->size && atoi(log->events + pos) < (int)tick) {
+		pos += __line_length(log, pos) + 1;
+	}
+	if (pos > log->size)
+		pos = log->size;
+	return (struct event_log) { log->events + pos, log->size - pos };
+}
 
-		/* Fork processes on schedule */
-		__fork_on_schedule();
+/**
+ * The tick of the last event in @log
+ */
+static unsigned int __last_tick(const struct event_log *log)
+{
+	size_t pos = log->size;
 
-		/* Ask scheduler to pick the next process to run */
-		prev = current;
-		current = sched->schedule();
+	if (pos && log->events[pos - 1] == '\n')
+		pos--;
+	while (pos && log->events[pos - 1] != '\n') {
+		pos--;
+	}
+	return pos < log->size ? atoi(log->events + pos) : 0;
+}
 
-		/* If the system has run a process in the previous tick */
-		if (prev) {
-			/* Update the process status */
-			if (prev->status == PROCESS_RUNNING) {
-				prev->status = PROCESS_READY;
-			}
+static void __print_event_line(const char *name, const struct event_log *log, size_t pos)
+{
+	if (pos >= log->size) {
+		printf("    %-32s (no more events)\n", name);
+	} else {
+		printf("    %-32s %.*s\n", name, (int)__line_length(log, pos), log->events + pos);
+	}
+}
 
-			/* Decommission it if completed */
-			if (prev->age == prev->lifespan) {
-				prev->status = PROCESS_EXIT;
-				__exit_process(prev);
-			}
-		}
+/**
+ * Compare each variant against the reference for each selected scheduler
+ * (all if none is selected). Return true if none of them diverges.
+ */
+static int __run_differential(char *const scriptfile)
+{
+	char imagefile[] = "/tmp/sched-image-XXXXXX";
+	struct sim_context ctx;
+	unsigned int nr_diverged = 0;
+	int fd;
+
+	__select_all_if_none();
+	__report_deadlocks = false;
+
+	/* Convert the script into the image for the variants loading the image */
+	fd = mkstemp(imagefile);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot create a temporary workload image\n");
+		return false;
+	}
+	close(fd);
+
+	sim_init(&ctx, __selected[0], 1);
+	sim = &ctx;
+	if (!__load_script(scriptfile) || !__write_workload(imagefile)) {
+		sim_destroy(&ctx);
+		unlink(imagefile);
+		return false;
+	}
+	sim_destroy(&ctx);
 
-		/* No process is ready to run at this moment */
-		if (!current) {
-			/* Quit simulation if no pending process exists */
-			if (list_empty(&readyqueue) && list_empty(&__forkqueue)) {
-				break;
-			}
+	for (unsigned int i = 0; i < __nr_selected; i++) {
+		struct event_log reference = { NULL, 0 };
 
-			/* Idle temporarily */
-			fprintf(stderr, "%3d: idle\n", ticks);
-		} else {
-			/* Execute the current process */
-			current->status = PROCESS_RUNNING;
+		if (!__run_engine(&__reference_engine, __selected[i], scriptfile, imagefile,
+					&reference)) {
+			free(reference.events);
+			nr_diverged++;
+			continue;
+		}
 
-			/* Ensure that @current is detached from any list */
-			assert(list_empty(&current->list));
+		for (unsigned int j = 0; j < sizeof(__engine_variants) / sizeof(*__engine_variants); j++) {
+			const struct engine_variant *variant = __engine_variants + j;
+			struct event_log log = { NULL, 0 };
+			struct event_log expected = reference;
+			size_t line_ref, line;
+			unsigned int nr_lines;
+			bool ran;
 
-			/* Try acquiring scheduled resources */
-			if (__run_current_acquire()) {
-				/* Succesfully acquired all the resources to make a progress */
-				__print_event(current->pid, "%d", current->pid);
+			if (variant->resume) {
+				unsigned int tick = __last_tick(&reference) / 2;
 
-				/* So, it ages by one tick */
-				current->age++;
+				/* The resumed run starts over from the events of the tick */
+				ran = __run_resumed(__selected[i], scriptfile, tick, &log);
+				expected = __events_since(&reference, tick);
+			} else {
+				ran = __run_engine(variant, __selected[i], scriptfile, imagefile, &log);
+			}
 
-				/* And performs scheduled releases */
-				__run_current_release();
+			if (!ran) {
+				printf("%s: %s: FAILED\n", __selected[i]->name, variant->name);
+				nr_diverged++;
+			} else if (__diverge_at(&expected, &log, &line_ref, &line, &nr_lines)) {
+				printf("%s: %s: diverged at tick %d after %u identical events\n",
+						__selected[i]->name, variant->name,
+						atoi(line_ref < expected.size ? expected.events + line_ref
+							: log.events + line), nr_lines);
+				__print_event_line(__reference_engine.name, &expected, line_ref);
+				__print_event_line(variant->name, &log, line);
+				nr_diverged++;
 			} else {
-				/**
-				 * The current is blocked while acquiring resource(s).
-				 * In this case, @current could not make a progress in this tick.
-				 * Thus, it does not get aged nor is unable to perform releases
-				 */
+				printf("%s: %s: %u events identical\n", __selected[i]->name,
+						variant->name, nr_lines);
 			}
+			free(log.events);
 		}
-
-		/* Increase the tick counter */
-		ticks++;
+		free(reference.events);
 	}
+
+	unlink(imagefile);
+	fastforward = false;
+	return nr_diverged == 0;
 }
 
-static void __initialize(void)
+static void __initialize(bool multirun)
 {
-	INIT_LIST_HEAD(&readyqueue);
-
-	for (int i = 0; i < NR_RESOURCES; i++) {
-		resources[i].owner = NULL;
-		INIT_LIST_HEAD(&(resources[i].waitqueue));
-	}
-
-	INIT_LIST_HEAD(&__forkqueue);
-
 	if (quiet)
 		return;
 	printf("               _              _ \n");
@@ -407,7 +3139,11 @@ static void __initialize(void)
 	printf("     |___/\\___|_| |_|\\___|\\__,_|\n");
 	printf("\n");
 	printf("                                 2024 Spring\n");
-	printf("      Simulating %s scheduler\n", sched->name);
+	if (multirun) {
+		printf("      Simulating multiple schedulers\n");
+	} else {
+		printf("      Simulating %s scheduler\n", sim->sched->name);
+	}
 	printf("\n");
 	printf("****************************************************\n");
 	printf("   N: Forked\n");
@@ -418,11 +3154,53 @@ static void __initialize(void)
 	printf("\n");
 }
 
+static void __select_scheduler(const struct scheduler *s)
+{
+	sched = s;
+	if (__nr_selected < NR_SCHEDULERS)
+		__selected[__nr_selected++] = s;
+}
+
 static void __print_usage(char *const name)
 {
-	printf("Usage: %s {-q} -[f|s|S|r|a|p|i] [process script file]\n", name);
+	printf("Usage: %s {-q} {-t trace} {-C image} {-m prefix} {-b {-j nr} {-l dir}} {-R nr} {-P nr} {-F} {-M} {-D} {--checkpoint-every nr {--checkpoint-dir dir}} {--resume-from tick} {--stream lookahead} {--mlfq-quanta q,...} {--mlfq-boost ticks} {--telemetry file {--telemetry-every ms}} {--stop-on-deadlock} -[f|s|S|r|a|p|c|i|d|v|L] [process script file]\n", name);
 	printf("\n");
-	printf("  -q: Run quietly\n\n");
+	printf("  -q: Run quietly\n");
+	printf("  -t: Write the events to @trace in the binary format as well\n");
+	printf("  -C: Convert the script into the workload image @image and exit.\n");
+	printf("      The image can be given in place of the script afterward\n");
+	printf("  -b: Batch mode. Run the selected schedulers (all if none is selected)\n");
+	printf("      over all the scripts given, and print the summary of the runs.\n");
+	printf("      Ticks/s and ns/tick are of the simulation itself, not the loading\n");
+	printf("  -j: Run @nr batch jobs at a time (the number of CPUs by default)\n");
+	printf("  -l: Write the events of each batch job to @dir/<script>.<option>\n");
+	printf("  -m: Run the selected schedulers (all if none is selected) in one go,\n");
+	printf("      writing the events of each to @prefix.<option of the scheduler>\n");
+	printf("  -R: Simulate @nr resources and reject the resource ids beyond.\n");
+	printf("      The resource ids in the script determine it by default\n");
+	printf("  -P: Simulate @nr CPUs, each with its own ready queue. Events are\n");
+	printf("      prefixed with <tick>/<cpu>\n");
+	printf("  -F: Fast-forward over the ticks where nothing changes\n");
+	printf("  -M: Print the scheduling metrics of each process and their summary\n");
+	printf("  -D: Differential mode. Check that the faster engine variants produce\n");
+	printf("      the same events as the reference engine for the selected schedulers\n");
+	printf("      (all if none is selected), and report the first tick they diverge in\n");
+	printf("  --checkpoint-every: Save the state of the simulation at every @nr ticks\n");
+	printf("      into @dir/<option of the scheduler>.<tick> (the current directory\n");
+	printf("      by default)\n");
+	printf("  --resume-from: Resume the simulation from the latest checkpoint at or\n");
+	printf("      before @tick in @dir. The script may be omitted\n");
+	printf("  --stream: Read the script along with the simulation, @lookahead ticks\n");
+	printf("      ahead, instead of loading it up front. The processes should be in\n");
+	printf("      the order of their start ticks. The resource table grows as the\n");
+	printf("      resource ids come in, up to %d, unless -R sizes it\n", MAX_RESOURCES);
+	printf("  --telemetry: Write the progress of the simulations running to @file\n");
+	printf("      every @ms milliseconds (1000 by default); the ticks, the ticks per\n");
+	printf("      second, the processes live, ready, running, and blocked, the resource\n");
+	printf("      with the most waiters, and the RSS\n");
+	printf("  --stop-on-deadlock: Stop the simulation with a failure as soon as the\n");
+	printf("      processes wait for each other's resources in a circle. The first\n");
+	printf("      such cycle is reported after the events either way\n\n");
 	printf("  -f: Use FCFS scheduler (default)\n");
 	printf("  -s: Use SJF scheduler\n");
 	printf("  -S: Use STCF scheduler\n");
@@ -431,43 +3209,201 @@ static void __print_usage(char *const name)
 	printf("  -a: Use Priority scheduler with aging\n");
 	printf("  -c: Use Priority scheduler with PCP\n");
 	printf("  -i: Use Priority scheduler with PIP\n");
+	printf("  -d: Use Stride scheduler\n");
+	printf("  -v: Use CFS-like scheduler\n");
+	printf("  -L: Use Multi-level feedback queue scheduler\n");
+	printf("  --mlfq-quanta: Quanta of the MLFQ levels from the top, in ticks\n");
+	printf("      (up to %u levels; 2,4,8,16 by default)\n", MLFQ_MAX_LEVELS);
+	printf("  --mlfq-boost: Move all processes back to the top MLFQ level every\n");
+	printf("      @ticks ticks, or never if 0 (128 by default)\n");
 	printf("\n");
 }
 
+/**
+ * Parse the comma-separated quanta of the MLFQ levels into @mlfq_params
+ */
+static bool __parse_mlfq_quanta(const char *str)
+{
+	unsigned int nr_levels = 0;
+	unsigned int quanta[MLFQ_MAX_LEVELS];
+
+	for (;;) {
+		char *end;
+		unsigned long quantum = strtoul(str, &end, 0);
+
+		if (end == str || (*end && *end != ',') || quantum == 0 || quantum > UINT_MAX ||
+				nr_levels == MLFQ_MAX_LEVELS) {
+			fprintf(stderr, "MLFQ quanta should be up to %u positive numbers separated by commas\n",
+					MLFQ_MAX_LEVELS);
+			return false;
+		}
+		quanta[nr_levels++] = quantum;
+		if (!*end)
+			break;
+		str = end + 1;
+	}
+
+	mlfq_params.nr_levels = nr_levels;
+	memcpy(mlfq_params.quanta, quanta, sizeof(*quanta) * nr_levels);
+	return true;
+}
+
+/**
+ * Options without the short form
+ */
+enum {
+	OPT_CHECKPOINT_EVERY = 0x100,
+	OPT_CHECKPOINT_DIR,
+	OPT_RESUME_FROM,
+	OPT_STREAM,
+	OPT_MLFQ_QUANTA,
+	OPT_MLFQ_BOOST,
+	OPT_TELEMETRY,
+	OPT_TELEMETRY_EVERY,
+	OPT_STOP_ON_DEADLOCK,
+};
+
+static const struct option __long_options[] = {
+	{ "checkpoint-every", required_argument, NULL, OPT_CHECKPOINT_EVERY },
+	{ "checkpoint-dir", required_argument, NULL, OPT_CHECKPOINT_DIR },
+	{ "resume-from", required_argument, NULL, OPT_RESUME_FROM },
+	{ "stream", required_argument, NULL, OPT_STREAM },
+	{ "mlfq-quanta", required_argument, NULL, OPT_MLFQ_QUANTA },
+	{ "mlfq-boost", required_argument, NULL, OPT_MLFQ_BOOST },
+	{ "telemetry", required_argument, NULL, OPT_TELEMETRY },
+	{ "telemetry-every", required_argument, NULL, OPT_TELEMETRY_EVERY },
+	{ "stop-on-deadlock", no_argument, NULL, OPT_STOP_ON_DEADLOCK },
+	{ NULL, 0, NULL, 0 },
+};
+
 int main(int argc, char *const argv[])
 {
 	int opt;
 	char *scriptfile;
-
-	while ((opt = getopt(argc, argv, "qfsSrpaich")) != -1) {
+	char *tracefile = NULL;
+	char *imagefile = NULL;
+	char *multiprefix = NULL;
+	bool batch = false;
+	bool differential = false;
+	unsigned int nr_workers = 0;
+	long long resume_from = -1;
+	long long lookahead = -1;
+	char *telemetryfile = NULL;
+	unsigned int telemetry_every = 1000;
+	struct sim_context ctx;
+
+	while ((opt = getopt_long(argc, argv, "qt:C:m:bj:l:R:P:FMDfsSrpacidvLh",
+					__long_options, NULL)) != -1) {
 		switch (opt) {
 		case 'q':
 			quiet = true;
 			break;
+		case 't':
+			tracefile = optarg;
+			break;
+		case 'C':
+			imagefile = optarg;
+			quiet = true;
+			break;
+		case 'm':
+			multiprefix = optarg;
+			break;
+		case 'b':
+			batch = true;
+			quiet = true;
+			break;
+		case 'j':
+			nr_workers = atoi(optarg);
+			break;
+		case 'l':
+			__batch_logdir = optarg;
+			break;
+		case 'R':
+			__resource_limit = atoi(optarg);
+			if (__resource_limit == 0 || __resource_limit > MAX_RESOURCES) {
+				fprintf(stderr, "The number of resources should be in [1, %d]\n",
+						MAX_RESOURCES);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'P':
+			nr_cpus = atoi(optarg);
+			if (nr_cpus == 0 || nr_cpus > MAX_CPUS) {
+				fprintf(stderr, "The number of CPUs should be in [1, %d]\n", MAX_CPUS);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'F':
+			fastforward = true;
+			break;
+		case 'M':
+			print_metrics = true;
+			break;
+		case 'D':
+			differential = true;
+			quiet = true;
+			break;
+		case OPT_CHECKPOINT_EVERY:
+			__checkpoint_every = atoi(optarg);
+			break;
+		case OPT_CHECKPOINT_DIR:
+			__checkpoint_dir = optarg;
+			break;
+		case OPT_RESUME_FROM:
+			resume_from = strtoul(optarg, NULL, 0);
+			break;
+		case OPT_STREAM:
+			lookahead = strtoul(optarg, NULL, 0);
+			break;
+		case OPT_MLFQ_QUANTA:
+			if (!__parse_mlfq_quanta(optarg))
+				return EXIT_FAILURE;
+			break;
+		case OPT_MLFQ_BOOST:
+			mlfq_params.boost_period = strtoul(optarg, NULL, 0);
+			break;
+		case OPT_TELEMETRY:
+			telemetryfile = optarg;
+			break;
+		case OPT_TELEMETRY_EVERY:
+			telemetry_every = strtoul(optarg, NULL, 0);
+			break;
+		case OPT_STOP_ON_DEADLOCK:
+			stop_on_deadlock = true;
+			break;
 
 		case 'f':
-			sched = &fcfs_scheduler;
+			__select_scheduler(&fcfs_scheduler);
 			break;
 		case 's':
-			sched = &sjf_scheduler;
+			__select_scheduler(&sjf_scheduler);
 			break;
 		case 'S':
-			sched = &stcf_scheduler;
+			__select_scheduler(&stcf_scheduler);
 			break;
 		case 'r':
-			sched = &rr_scheduler;
+			__select_scheduler(&rr_scheduler);
 			break;
 		case 'p':
-			sched = &prio_scheduler;
+			__select_scheduler(&prio_scheduler);
 			break;
 		case 'a':
-			sched = &pa_scheduler;
+			__select_scheduler(&pa_scheduler);
 			break;
 		case 'i':
-			sched = &pip_scheduler;
+			__select_scheduler(&pip_scheduler);
 			break;
 		case 'c':
-			sched = &pcp_scheduler;
+			__select_scheduler(&pcp_scheduler);
+			break;
+		case 'd':
+			__select_scheduler(&stride_scheduler);
+			break;
+		case 'v':
+			__select_scheduler(&cfs_scheduler);
+			break;
+		case 'L':
+			__select_scheduler(&mlfq_scheduler);
 			break;
 		case 'h':
 		default:
@@ -476,28 +3412,128 @@ int main(int argc, char *const argv[])
 		}
 	}
 
-	if (optind >= argc) {
+	/* The checkpoint has all it takes to resume, so the script is optional then */
+	if (optind >= argc && resume_from < 0) {
 		__print_usage(argv[0]);
 		return EXIT_FAILURE;
 	}
 
-	scriptfile = argv[optind];
+	scriptfile = optind < argc ? argv[optind] : NULL;
+
+	if ((differential || batch) && (__checkpoint_every || resume_from >= 0)) {
+		fprintf(stderr, "Checkpoints cannot be used together with -D or -b\n");
+		return EXIT_FAILURE;
+	}
+
+	if (lookahead >= 0 && (differential || batch || multiprefix || imagefile ||
+				__checkpoint_every || resume_from >= 0)) {
+		fprintf(stderr, "--stream cannot be used together with -D, -b, -m, -C, "
+				"or checkpoints\n");
+		return EXIT_FAILURE;
+	}
+
+	if (telemetryfile) {
+		if (!telemetry_start(telemetryfile, telemetry_every))
+			return EXIT_FAILURE;
+		atexit(telemetry_stop);
+	}
+
+	if (differential) {
+		if (batch || multiprefix || tracefile || imagefile || fastforward || nr_cpus > 1) {
+			fprintf(stderr, "-D cannot be used together with -b, -m, -t, -C, -F, or -P\n");
+			return EXIT_FAILURE;
+		}
+		return __run_differential(scriptfile) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (batch) {
+		if (multiprefix || tracefile || imagefile) {
+			fprintf(stderr, "-b cannot be used together with -m, -t, or -C\n");
+			return EXIT_FAILURE;
+		}
+		if (nr_workers == 0) {
+			long nr_online = sysconf(_SC_NPROCESSORS_ONLN);
+			nr_workers = nr_online > 0 ? nr_online : 1;
+		}
+		return __run_batch(argv + optind, argc - optind, nr_workers) ?
+				EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (multiprefix && tracefile) {
+		fprintf(stderr, "-t cannot be used together with -m\n");
+		return EXIT_FAILURE;
+	}
 
-	__initialize();
+	if (resume_from >= 0 && (multiprefix || imagefile)) {
+		fprintf(stderr, "--resume-from cannot be used together with -m or -C\n");
+		return EXIT_FAILURE;
+	}
 
-	if (!__load_script(scriptfile)) {
+	if (fastforward && nr_cpus > 1) {
+		fprintf(stderr, "-F works only on a single CPU\n");
 		return EXIT_FAILURE;
 	}
 
-	if (sched->initialize && sched->initialize()) {
+	sim_init(&ctx, sched, nr_cpus);
+	sim = &ctx;
+
+	if (tracefile && !__open_trace(tracefile)) {
 		return EXIT_FAILURE;
 	}
 
-	__do_simulation();
+	__initialize(!!multiprefix);
+
+	if (resume_from >= 0) {
+		ctx.__resume = __open_checkpoint(sched, resume_from);
+		if (!ctx.__resume) {
+			return EXIT_FAILURE;
+		}
+	} else if (lookahead >= 0) {
+		ctx.__stream = __open_stream(scriptfile, lookahead);
+		if (!ctx.__stream) {
+			return EXIT_FAILURE;
+		}
+		if (!quiet)
+			printf("Streaming %s\n\n", scriptfile);
+
+		/* Resources are not known in advance. Grow the table as they show up */
+		sim_setup_resources(&ctx, __resource_limit);
+	} else {
+		if (!__load_script(scriptfile)) {
+			return EXIT_FAILURE;
+		}
+
+		if (imagefile) {
+			return __write_workload(imagefile) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		__sort_forkqueue();
+		sim_setup_resources(&ctx, __resource_limit ? __resource_limit : ctx.__nr_resources_used);
+	}
+
+	if (multiprefix) {
+		if (!__run_schedulers(multiprefix)) {
+			return EXIT_FAILURE;
+		}
+	} else {
+		if (!__run_simulation()) {
+			return EXIT_FAILURE;
+		}
+		__close_trace();
+		if (ctx.__resume) {
+			fclose(ctx.__resume);
+		}
+		if (ctx.__stream) {
+			__close_stream(ctx.__stream);
+		}
 
-	if (sched->finalize) {
-		sched->finalize();
+		if (print_metrics) {
+			__print_metrics();
+		}
+		__print_profile();
 	}
 
+	sim_destroy(&ctx);
+
 	return EXIT_SUCCESS;
 }
@@ -16,6 +16,8 @@
 #ifndef __SCHED_H__
 #define __SCHED_H__
 
+struct checkpoint;
+
 /***********************************************************************
  * struct scheduler
  *
@@ -27,6 +29,17 @@
 struct scheduler {
 	const char *name;
 
+	/***********************************************************************
+	 * bool nonpreemptive
+	 *
+	 * DESCRIPTION
+	 *   Set this if schedule() keeps returning @current as long as it is
+	 *   neither blocked nor completed, regardless of the other processes.
+	 *   In the fast-forward mode, the simulator relies on this to run
+	 *   @current over uneventful ticks without calling schedule().
+	 */
+	bool nonpreemptive;
+
 	/***********************************************************************
 	 * int initialize(void)
 	 *
@@ -37,6 +50,9 @@ struct scheduler {
 	 * RETURN VALUE
 	 *   Return 0 on successful initialization.
 	 *   Return other value on error, which leads the program to exit.
+	 *
+	 *   In the multi-CPU mode, initialize(), finalize(), and schedule() are
+	 *   called for each CPU, with @current and @readyqueue of that CPU.
 	 */
 	int (*initialize)(void);
 
@@ -91,6 +107,23 @@ struct scheduler {
 	struct process *(*schedule)(void);
 
 
+	/***********************************************************************
+	 * struct process *steal(void)
+	 *
+	 * DESCRIPTION
+	 *   Detach a ready process from this CPU so that another CPU running out
+	 *   of processes can run it. Called only in the multi-CPU mode, with
+	 *   @current and @readyqueue of the CPU to steal from. The stolen process
+	 *   is put into @readyqueue of the stealing CPU. If this is NULL, the first
+	 *   process in @readyqueue is taken.
+	 *
+	 * RETURN
+	 *   the process to hand over
+	 *   NULL if there is no process to hand over
+	 */
+	struct process *(*steal)(void);
+
+
 	/***********************************************************************
 	 * bool acquire(int resource_id)
 	 *
@@ -111,6 +144,46 @@ struct scheduler {
 	 *   Callbacked to release the resource @resource_id
 	 */
 	void (*release)(int);
+
+
+	/***********************************************************************
+	 * void checkpoint(struct checkpoint *checkpoint)
+	 * int restore(struct checkpoint *checkpoint)
+	 *
+	 * DESCRIPTION
+	 *   Save what the scheduler keeps in @sched_data into @checkpoint, and
+	 *   rebuild it from @checkpoint when the simulation is resumed. Called for
+	 *   each CPU, and restore() is called after initialize(). Processes should
+	 *   be saved with checkpoint_write_process() (see checkpoint.h), and
+	 *   prioq_checkpoint(), agingq_checkpoint(), fairq_checkpoint(), and
+	 *   arrayq_checkpoint() save the whole queue. Schedulers that set up
+	 *   @sched_data without these cannot be checkpointed.
+	 *
+	 * RETURN VALUE
+	 *   restore() returns 0 on success, like initialize() does
+	 */
+	void (*checkpoint)(struct checkpoint *);
+	int (*restore)(struct checkpoint *);
 };
 
+/***********************************************************************
+ * struct mlfq_params
+ *
+ * DESCRIPTION
+ *   Shape of the multi-level feedback queue scheduler. A process starts at
+ *   level 0 and moves one level down whenever it has run for the quantum of
+ *   its level, and all processes go back to level 0 at every multiple of
+ *   @boost_period ticks. Set with --mlfq-quanta and --mlfq-boost before the
+ *   simulation starts, and read-only while it runs.
+ */
+#define MLFQ_MAX_LEVELS	64
+
+struct mlfq_params {
+	unsigned int nr_levels;
+	unsigned int quanta[MLFQ_MAX_LEVELS];	/* Quantum of each level in ticks */
+	unsigned int boost_period;				/* No boost if 0 */
+};
+
+extern struct mlfq_params mlfq_params;
+
 #endif
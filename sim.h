@@ -0,0 +1,149 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "list_head.h"
+#include "process.h"
+#include "resource.h"
+#include "pool.h"
+#include "metrics.h"
+#include "profile.h"
+#include "telemetry.h"
+
+struct scheduler;
+struct workload_stream;
+
+/***********************************************************************
+ * struct sim_cpu
+ *
+ * DESCRIPTION
+ *   A CPU in the simulation. Each CPU runs its own @current out of its own
+ *   @readyqueue, and the scheduler keeps its per-CPU data in @sched_data.
+ *   The schedulers reach the CPU they are called for through the macros
+ *   below, so a scheduler written for a single CPU runs on each CPU as is.
+ */
+struct sim_cpu {
+	struct process *__current;		/* The process that is currently running */
+	struct list_head __readyqueue;	/* Processes ready to run */
+	void *__sched_data;				/* Private to the scheduler. Set it up in
+									   initialize() and tear it down in finalize() */
+
+	unsigned int __nr_processes;	/* # of live processes homed on this CPU */
+};
+
+#define MAX_CPUS	256				/* CPU ids are 8-bit wide in the binary trace */
+
+/***********************************************************************
+ * struct sim_context
+ *
+ * DESCRIPTION
+ *   All the state of a simulation. Each thread works on the simulation that
+ *   @sim points to, so independent simulations can run on different threads
+ *   at the same time without sharing anything mutable.
+ *
+ *   The schedulers access the state of their simulation through @current,
+ *   @readyqueue, @ticks, and @resources defined below, just like they used to
+ *   access the global variables. @current and @readyqueue are those of the CPU
+ *   the scheduler is called for.
+ */
+struct sim_context {
+	struct sim_cpu *__cpus;			/* CPUs in the system */
+	unsigned int __nr_cpus;
+	struct sim_cpu *__cpu;			/* The CPU being simulated at the moment */
+
+	unsigned int __ticks;			/* # of ticks since the simulation was started */
+	struct resource *__resources;	/* Resources in the system */
+	unsigned int __nr_resources;	/* # of entries in @__resources */
+	unsigned int __nr_resources_used;
+									/* Highest resource id in the script plus one */
+
+	const struct scheduler *sched;	/* The scheduler to simulate */
+
+	/** DO NOT ACCESS FOLLOWING VARIABLES. THESE ARE USED FOR SIMULATOR IMPLEMENTATION **/
+	struct list_head __forkqueue;	/* Processes to fork */
+	struct workload_stream *__stream;
+									/* Where the processes come from as the simulation
+									   goes. NULL if they are all loaded up front */
+
+	struct pool __process_pool;		/* Slabs for struct process */
+	struct pool __process_cold_pool;
+									/* and for their struct process_cold */
+	struct pool __resource_schedule_pool;
+									/* Slabs for struct resource_schedule */
+	struct pool __resource_waiters_pool;
+									/* Slabs for struct resource_waiters */
+	struct pool __prioq_pool;		/* Slabs for the priority waitqueues */
+
+	char *__events;					/* Events waiting to be written out */
+	size_t __nr_events_bytes;
+	FILE *__events_stream;			/* Where the events go. NULL for stderr */
+	bool __discard_events;			/* Drop the events instead of writing them out */
+	const char *__script;			/* Script to name in the reports. NULL if only one */
+
+	FILE *__trace;					/* Binary event trace. NULL if not tracing */
+
+	FILE *__resume;					/* Checkpoint to resume from. NULL to start afresh */
+	unsigned int __next_checkpoint;	/* When to write the next checkpoint */
+
+	unsigned long long *__active_resources;
+									/* Bit n is set if resource n is owned or waited */
+	unsigned int __nr_inverted;		/* Sum of @__nr_inverted of the resources */
+	unsigned int __inverted_since;	/* The tick @__nr_inverted is accounted up to */
+	struct process *__deadlocked;	/* A process in the first cycle formed in the
+									   wait-for graph, or NULL */
+	unsigned int __deadlocked_at;	/* The tick the cycle formed in */
+
+	struct metrics __metrics;		/* Scheduling metrics of the simulation */
+	struct telemetry __telemetry;	/* Snapshot for the telemetry thread */
+#ifdef CONFIG_PROFILE
+	struct profile __profile;		/* Costs of the scheduler callbacks */
+#endif
+};
+
+/**
+ * The simulation the calling thread is working on
+ */
+extern __thread struct sim_context *sim;
+
+#define current		(sim->__cpu->__current)
+#define readyqueue	(sim->__cpu->__readyqueue)
+#define sched_data	(sim->__cpu->__sched_data)
+#define this_cpu	((unsigned int)(sim->__cpu - sim->__cpus))
+#define NR_CPUS		(sim->__nr_cpus)
+#define ticks		(sim->__ticks)
+#define resources	(sim->__resources)
+#define NR_RESOURCES	(sim->__nr_resources)
+
+/**
+ * Set up @ctx to simulate @sched on @nr_cpus CPUs from the scratch, and tear
+ * it down
+ */
+void sim_init(struct sim_context *ctx, const struct scheduler *sched, unsigned int nr_cpus);
+void sim_destroy(struct sim_context *ctx);
+
+/**
+ * Allocate the table of @nr_resources resources for @ctx, and grow it to
+ * @nr_resources entries in the middle of the simulation
+ */
+void sim_setup_resources(struct sim_context *ctx, unsigned int nr_resources);
+void sim_grow_resources(struct sim_context *ctx, unsigned int nr_resources);
+
+#endif
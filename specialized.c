@@ -0,0 +1,26 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/***********************************************************************
+ * Specialized build of the simulator
+ *
+ * DESCRIPTION
+ *   make SPECIALIZE=1 compiles the schedulers and the simulator as this one
+ *   translation unit with CONFIG_SPECIALIZE, so that the main loop
+ *   instantiated for each scheduler sees its callbacks and can inline them.
+ *   See __do_simulation() in sched.c.
+ */
+#include "pa2.c"
+#include "sched.c"
@@ -0,0 +1,208 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "telemetry.h"
+
+static FILE *__file = NULL;
+static unsigned int __interval_ms;
+static double __started_at;
+
+static pthread_t __telemetry;
+static pthread_mutex_t __lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t __wakeup;
+static bool __stopping = false;
+
+/* The simulations running at the moment. Protected by @__lock */
+static struct telemetry *__running = NULL;
+
+static double __now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Resident set size of the whole process in KiB, or 0 if unknown
+ */
+static unsigned long __rss_kib(void)
+{
+	unsigned long size, resident = 0;
+	FILE *statm = fopen("/proc/self/statm", "r");
+
+	if (!statm)
+		return 0;
+	if (fscanf(statm, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+	fclose(statm);
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void __print_snapshot(struct telemetry *t, double taken_at)
+{
+	fprintf(__file, "time=%.3f sched=%c ticks=%u", taken_at - __started_at,
+			t->__option, t->tick);
+	if (t->__last_at && taken_at > t->__last_at) {
+		fprintf(__file, " ticks/s=%.0f",
+				(t->tick - t->__last_tick) / (taken_at - t->__last_at));
+	} else {
+		fprintf(__file, " ticks/s=-");
+	}
+	fprintf(__file, " processes=%u ready=%u running=%u blocked=%u", t->nr_processes,
+			t->nr_ready, t->nr_running, t->nr_blocked);
+	if (t->hottest != UINT_MAX) {
+		fprintf(__file, " hottest=%u:%u", t->hottest, t->nr_hottest_waiters);
+	} else {
+		fprintf(__file, " hottest=-");
+	}
+	fprintf(__file, " rss=%luKiB\n", __rss_kib());
+	fflush(__file);
+
+	t->__last_at = taken_at;
+	t->__last_tick = t->tick;
+}
+
+static void *__telemetry_thread(void *arg)
+{
+	struct timespec deadline;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	pthread_mutex_lock(&__lock);
+	while (!__stopping) {
+		double now;
+
+		deadline.tv_sec += __interval_ms / 1000;
+		deadline.tv_nsec += __interval_ms % 1000 * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		while (!__stopping &&
+				pthread_cond_timedwait(&__wakeup, &__lock, &deadline) != ETIMEDOUT)
+			;
+		if (__stopping)
+			break;
+
+		now = __now();
+		for (struct telemetry *t = __running; t; t = t->__next) {
+			/* Still there if the simulation has not got to the next tick yet */
+			if (__atomic_load_n(&t->requested, __ATOMIC_ACQUIRE))
+				continue;
+
+			t->__requested_at = now;
+			__atomic_store_n(&t->requested, 1, __ATOMIC_RELEASE);
+		}
+	}
+	pthread_mutex_unlock(&__lock);
+	return NULL;
+}
+
+bool telemetry_start(const char *filename, unsigned int interval_ms)
+{
+	pthread_condattr_t attr;
+
+	__file = fopen(filename, "w");
+	if (!__file) {
+		fprintf(stderr, "Cannot open %s\n", filename);
+		return false;
+	}
+	__interval_ms = interval_ms ? interval_ms : 1;
+	__started_at = __now();
+
+	/* Wait on the same clock as the deadlines */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&__wakeup, &attr);
+	pthread_condattr_destroy(&attr);
+
+	if (pthread_create(&__telemetry, NULL, __telemetry_thread, NULL)) {
+		fprintf(stderr, "Cannot start the telemetry thread\n");
+		pthread_cond_destroy(&__wakeup);
+		fclose(__file);
+		__file = NULL;
+		return false;
+	}
+	return true;
+}
+
+void telemetry_stop(void)
+{
+	if (!__file)
+		return;
+
+	pthread_mutex_lock(&__lock);
+	__stopping = true;
+	pthread_cond_signal(&__wakeup);
+	pthread_mutex_unlock(&__lock);
+	pthread_join(__telemetry, NULL);
+
+	pthread_cond_destroy(&__wakeup);
+	fclose(__file);
+	__file = NULL;
+}
+
+void telemetry_register(struct telemetry *t, char option)
+{
+	memset(t, 0x00, sizeof(*t));
+	if (!__file)
+		return;
+
+	t->__option = option;
+
+	pthread_mutex_lock(&__lock);
+	t->__next = __running;
+	__running = t;
+	pthread_mutex_unlock(&__lock);
+}
+
+bool telemetry_enabled(void)
+{
+	return __file != NULL;
+}
+
+void telemetry_published(struct telemetry *t)
+{
+	pthread_mutex_lock(&__lock);
+	__print_snapshot(t, t->__requested_at);
+	__atomic_store_n(&t->requested, 0, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&__lock);
+}
+
+void telemetry_unregister(struct telemetry *t)
+{
+	if (!__file)
+		return;
+
+	pthread_mutex_lock(&__lock);
+	for (struct telemetry **pt = &__running; *pt; pt = &(*pt)->__next) {
+		if (*pt == t) {
+			*pt = t->__next;
+			break;
+		}
+	}
+	__print_snapshot(t, __now());
+	pthread_mutex_unlock(&__lock);
+}
@@ -0,0 +1,89 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <stdbool.h>
+
+/***********************************************************************
+ * Live telemetry
+ *
+ * DESCRIPTION
+ *   sched --telemetry appends a line on the progress of each simulation
+ *   running at the moment to a side file every --telemetry-every
+ *   milliseconds, such as
+ *
+ *     time=12.004 sched=r ticks=48211096 ticks/s=4012345 processes=812
+ *     ready=790 running=1 blocked=21 hottest=3:12 rss=30720KiB
+ *
+ *   (in one line), where hottest is the resource with the most waiters and
+ *   the number of them, and one more line when the simulation ends. A
+ *   thread of its own keeps the time. A simulation looks at @requested once
+ *   a tick, and fills in the snapshot and writes it out only when the thread
+ *   has asked for one, so the main loop takes a lock and a syscall only once
+ *   in an interval.
+ *
+ *   The thread sets @requested, and the simulation clears it after the
+ *   snapshot is written out. The snapshot is only ever touched by the
+ *   simulation, and the rest by either side under the lock.
+ */
+struct telemetry {
+	int requested;
+
+	/* The snapshot, filled in by the simulation */
+	unsigned int tick;
+	unsigned int nr_processes;		/* # of live processes */
+	unsigned int nr_ready;
+	unsigned int nr_running;
+	unsigned int nr_blocked;		/* # of processes waiting for resources */
+	unsigned int hottest;			/* Resource with the most waiters. UINT_MAX if none */
+	unsigned int nr_hottest_waiters;
+
+	/** Private to the telemetry thread **/
+	char __option;					/* Option of the scheduler being simulated */
+	struct telemetry *__next;		/* In the list of simulations running */
+	double __requested_at;			/* When the snapshot was requested. 0 if not yet */
+	double __last_at;				/* When the last snapshot printed was taken */
+	unsigned int __last_tick;
+};
+
+/**
+ * Start and stop the telemetry thread writing to @filename
+ */
+bool telemetry_start(const char *filename, unsigned int interval_ms);
+void telemetry_stop(void);
+
+/**
+ * Report @t of a simulation of the scheduler of @option from now on, and
+ * stop reporting it. The snapshot filled in last is written out when
+ * unregistered. They do nothing if the telemetry is not started
+ */
+void telemetry_register(struct telemetry *t, char option);
+void telemetry_unregister(struct telemetry *t);
+
+bool telemetry_enabled(void);
+
+static inline bool telemetry_requested(struct telemetry *t)
+{
+	return __atomic_load_n(&t->requested, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Write out the snapshot filled in as requested
+ */
+void telemetry_published(struct telemetry *t);
+
+#endif
@@ -0,0 +1,60 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+
+/***********************************************************************
+ * Binary event trace
+ *
+ * DESCRIPTION
+ *   With -t option, the simulator writes every event it prints to stderr
+ *   into a file as well, as a stream of fixed-width records following a
+ *   struct trace_header. The fields are in the host byte order.
+ *   sched-decode turns the file back into the text format.
+ */
+#define TRACE_MAGIC		"SCHEDTRC"
+#define TRACE_VERSION	2
+
+struct trace_header {
+	char magic[8];				/* TRACE_MAGIC without the trailing '\0' */
+	uint32_t version;			/* TRACE_VERSION */
+	uint32_t record_size;		/* sizeof(struct trace_record) */
+	uint32_t nr_cpus;			/* # of CPUs simulated */
+	uint32_t __reserved;
+};
+
+enum trace_event_type {
+	TRACE_FORK		= 'N',		/* Forked */
+	TRACE_EXIT		= 'X',		/* Finished */
+	TRACE_BLOCK		= '=',		/* Blocked on @resource_id */
+	TRACE_ACQUIRE	= '+',		/* Acquired @resource_id */
+	TRACE_RELEASE	= '-',		/* Released @resource_id */
+	TRACE_RUN		= 'R',		/* Ran for the tick */
+	TRACE_IDLE		= 'I',		/* No process ran for the tick */
+};
+
+struct trace_record {
+	uint32_t tick;
+	uint32_t pid;				/* 0 for TRACE_IDLE */
+	uint32_t prio;				/* Effective priority at the event */
+	uint16_t resource_id;		/* Only for TRACE_BLOCK, ACQUIRE, and RELEASE */
+	uint8_t type;				/* enum trace_event_type */
+	uint8_t cpu;				/* CPU the event happened on */
+};
+
+#endif
@@ -0,0 +1,58 @@
+/**********************************************************************
+ * Copyright (c) 2019-2024
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __WORKLOAD_H__
+#define __WORKLOAD_H__
+
+#include <stdint.h>
+
+/***********************************************************************
+ * Precompiled workload image
+ *
+ * DESCRIPTION
+ *   sched -C converts a process description file into this image, which
+ *   can be given to sched in place of the script. The image consists of
+ *   a struct workload_header, the process table, and a flat array of the
+ *   resource acquisition schedules. The processes are in the script order and
+ *   refer to their schedules with @first_schedule and @nr_schedules.
+ *   The fields are in the host byte order.
+ */
+#define WORKLOAD_MAGIC		"SCHEDWKL"
+#define WORKLOAD_VERSION	1
+
+struct workload_header {
+	char magic[8];				/* WORKLOAD_MAGIC without the trailing '\0' */
+	uint32_t version;			/* WORKLOAD_VERSION */
+	uint32_t nr_processes;
+	uint64_t nr_schedules;
+};
+
+struct workload_process {
+	uint32_t pid;
+	uint32_t starts_at;
+	uint32_t lifespan;
+	uint32_t prio;
+	uint64_t first_schedule;	/* Index of the first schedule of this process */
+	uint32_t nr_schedules;
+	uint32_t __reserved;
+};
+
+struct workload_schedule {
+	uint32_t resource_id;
+	uint32_t at;
+	uint32_t duration;
+};
+
+#endif